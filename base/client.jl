@@ -214,6 +214,17 @@ end
 # try to include() a file, ignoring if not found
 try_include(path::String) = isfile(path) && include(path)
 
+# write precompile statements for everything compiled in this session
+function trace_compile(file::String)
+    start_compile_log()
+    atexit() do
+        sigs = stop_compile_log()
+        open(file, "w") do io
+            write_precompile(io, sigs)
+        end
+    end
+end
+
 function process_options(args::Vector{UTF8String})
     global bind_addr
     quiet = false
@@ -268,6 +279,9 @@ function process_options(args::Vector{UTF8String})
             exit(0)
         elseif args[i]=="--no-history"
             history = false
+        elseif args[i]=="--trace-compile"
+            i+=1
+            trace_compile(args[i])
         elseif args[i] == "-f" || args[i] == "--no-startup"
             startup = false
         elseif args[i] == "-F"
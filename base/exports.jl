@@ -1019,6 +1019,8 @@ export
     gc,
     gc_disable,
     gc_enable,
+    gc_log,
+    gc_stats,
     precompile,
 
 # misc
@@ -1261,6 +1263,8 @@ export
     @elapsed,
     @allocated,
     @profile,
+    @profile_allocs,
+    @profile_dispatch,
     @which,
     @windows,
     @unix,
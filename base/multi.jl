@@ -1561,6 +1561,14 @@ function event_loop(isclient)
                         if any_gc_flag
                             flush_gc_msgs()
                         end
+                        # nothing else to do; run finalizers queued by the collector
+                        ccall(:jl_gc_run_finalizers, Csize_t, ())
+                        # and optimize functions queued by tiered compilation,
+                        # one at a time so that events are still handled promptly
+                        if ccall(:jl_tier_run_queue, Cint, (Cint,), 1) > 0
+                            process_events(false)
+                            continue
+                        end
                         c = process_events(true)
                         if c==0 && eventloop()!=C_NULL && isempty(Workqueue) && !any_gc_flag
                             # if there are no active handles and no runnable tasks, just
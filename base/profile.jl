@@ -2,7 +2,7 @@ module Profile
 
 import Base: hash, isequal
 
-export @profile
+export @profile, @profile_allocs, @profile_dispatch
 
 macro profile(ex)
     quote
@@ -18,6 +18,28 @@ macro profile(ex)
     end
 end
 
+macro profile_allocs(ex)
+    quote
+        try
+            start_allocs()
+            $(esc(ex))
+        finally
+            stop_allocs()
+        end
+    end
+end
+
+macro profile_dispatch(ex)
+    quote
+        try
+            start_dispatch()
+            $(esc(ex))
+        finally
+            stop_dispatch()
+        end
+    end
+end
+
 ####
 #### User-level functions
 ####
@@ -59,6 +81,75 @@ function retrieve(;C = false)
     return copy(data), lidict
 end
 
+# allocation profiling: a backtrace is taken every sample_bytes bytes allocated
+function init_allocs(n::Integer, sample_bytes::Integer)
+    status = ccall(:jl_alloc_profile_init, Cint, (Csize_t, Csize_t), n, sample_bytes)
+    if status == -1
+        error("could not allocate space for ", n, " instruction pointers")
+    elseif status == -2
+        error("cannot change the allocation profiler settings while it is running")
+    end
+end
+
+clear_allocs() = ccall(:jl_alloc_profile_clear_data, Void, ())
+
+function fetch_allocs()
+    len = convert(Int, ccall(:jl_alloc_profile_len_data, Csize_t, ()))
+    if ccall(:jl_alloc_profile_dropped, Csize_t, ()) > 0
+        warn("The allocation profile buffer is full. To profile for longer runs, call\nProfile.init_allocs() with a larger buffer and/or a larger sampling interval.")
+    end
+    p = convert(Ptr{Uint}, ccall(:jl_alloc_profile_get_data, Ptr{Uint8}, ()))
+    pointer_to_array(p, (len,))
+end
+
+# the type allocated at each backtrace in fetch_allocs(), or nothing for
+# buffers such as array data
+alloc_types() = ccall(:jl_alloc_profile_get_types, Any, ())::Vector{Any}
+
+# number of backtraces taken for each allocated type; each stands for
+# sample_bytes bytes allocated
+function alloc_counts()
+    counts = Dict{Any,Int}()
+    for t in alloc_types()
+        counts[t] = get(counts, t, 0)+1
+    end
+    counts
+end
+
+# dispatch profiling: per generic function, how calls were dispatched
+immutable DispatchCount
+    name::Symbol
+    calls::Int      # calls through the dispatcher
+    hits::Int       # answered by the method cache
+    slow::Int       # needed a full method lookup
+    compiles::Int   # compiled the method they called
+    time::Float64   # seconds spent in full lookups
+end
+
+clear_dispatch() = ccall(:jl_dispatch_profile_clear, Void, ())
+
+function fetch_dispatch()
+    mts = ccall(:jl_dispatch_profile_get_tables, Any, ())::Vector{Any}
+    n = length(mts)
+    counts = Array(Uint64, 4n)
+    times = Array(Float64, n)
+    ccall(:jl_dispatch_profile_counts, Void, (Ptr{Uint64}, Ptr{Float64}, Csize_t),
+          counts, times, n)
+    res = [DispatchCount(mts[i].name, counts[4i-3], counts[4i-2], counts[4i-1],
+                         counts[4i], times[i]) for i = 1:n]
+    sort!(res, by=c->c.calls, rev=true)
+end
+
+function print_dispatch(io::IO, data::Vector{DispatchCount})
+    @printf(io, "%12s %12s %12s %10s %10s  %s\n",
+            "calls", "cache hits", "slow path", "compiles", "time (s)", "function")
+    for c in data
+        @printf(io, "%12d %12d %12d %10d %10.4f  %s\n",
+                c.calls, c.hits, c.slow, c.compiles, c.time, c.name)
+    end
+end
+print_dispatch(io::IO=STDOUT) = print_dispatch(io, fetch_dispatch())
+
 ####
 #### Internal interface
 ####
@@ -81,6 +172,19 @@ stop_timer() = ccall(:jl_profile_stop_timer, Void, ())
 
 is_running() = bool(ccall(:jl_profile_is_running, Cint, ()))
 
+function start_allocs()
+    if ccall(:jl_alloc_profile_maxlen_data, Csize_t, ()) == 0
+        init_allocs(1_000_000, 512*1024)
+    end
+    ccall(:jl_alloc_profile_start, Cint, ())
+end
+
+stop_allocs() = ccall(:jl_alloc_profile_stop, Void, ())
+
+start_dispatch() = ccall(:jl_dispatch_profile_start, Void, ())
+
+stop_dispatch() = ccall(:jl_dispatch_profile_stop, Void, ())
+
 get_data_pointer() = convert(Ptr{Uint}, ccall(:jl_profile_get_data, Ptr{Uint8}, ()))
 
 len_data() = convert(Int, ccall(:jl_profile_len_data, Csize_t, ()))
@@ -120,6 +120,84 @@ function length(mt::MethodTable)
     n
 end
 
+# limits on the number of specializations compiled for each method; beyond
+# them, new argument types are widened to the declared ones. 0 is no limit,
+# and a function's own limit overrides the global one.
+max_specializations() = int(unsafe_load(cglobal(:jl_max_specializations, Csize_t)))
+max_specializations(f::Function) = methods(f).max_specializations
+set_max_specializations(n::Integer) =
+    (unsafe_store!(cglobal(:jl_max_specializations, Csize_t), n); nothing)
+set_max_specializations(f::Function, n::Integer) =
+    (methods(f).max_specializations = n; nothing)
+
+# number of method cache entries and of specializations of f
+function method_cache_size(f::Function)
+    methods(f)
+    sz = Array(Csize_t, 2)
+    ccall(:jl_method_cache_size, Void, (Any, Ptr{Csize_t}), f, sz)
+    (int(sz[1]), int(sz[2]))
+end
+
+# record the specializations compiled from now on. stop_compile_log returns
+# them as (module, function name, argument types) tuples, and
+# write_precompile writes them as precompile statements, e.g. to
+# base/userimg.jl, which is included when building the system image, so
+# that their native code is saved in it.
+start_compile_log() = ccall(:jl_start_compile_log, Void, ())
+
+function stop_compile_log()
+    sigs = {}
+    for li in ccall(:jl_stop_compile_log, Any, ())::Array{Any,1}
+        m, name = li.module, li.name
+        if isdefined(m, name) && isgeneric(eval(m, name))
+            push!(sigs, (m, name, li.specTypes))
+        end
+    end
+    sigs
+end
+
+function precompile_module(m::Module)
+    p = fullname(m)
+    isempty(p) ? "Main" : join([string(s) for s in p], ".")
+end
+
+# a type written so that it evaluates to itself in any module: every name
+# is qualified by the module it belongs to
+function precompile_repr(t::ANY)
+    if isa(t, DataType)
+        if isvarargtype(t)
+            return string(precompile_repr(t.parameters[1]), "...")
+        end
+        s = string(precompile_module(t.name.module), ".", t.name.name)
+        if length(t.parameters) > 0
+            s = string(s, "{", join([precompile_repr(p) for p in t.parameters], ","), "}")
+        end
+        return s
+    elseif isa(t, Tuple)
+        length(t) == 1 && return string("(", precompile_repr(t[1]), ",)")
+        return string("(", join([precompile_repr(p) for p in t], ", "), ")")
+    elseif isa(t, UnionType)
+        return string("Union(", join([precompile_repr(p) for p in t.types], ", "), ")")
+    end
+    repr(t)
+end
+
+function write_precompile(io::IO, sigs)
+    for (m, name, types) in sigs
+        println(io, "precompile(", precompile_module(m), ".(", repr(name), "), ",
+                precompile_repr(types), ")")
+    end
+end
+
+# with loop and SLP vectorization enabled (julia --vectorize=yes), turn it
+# off or back on for the methods of f. this affects code compiled
+# afterwards; specializations that are already compiled keep their code.
+function set_vectorize(f::Function, on::Bool)
+    for m in methods(f)
+        ccall(:jl_set_vectorize, Void, (Any, Cint), m.func.code, on)
+    end
+end
+
 start(mt::MethodTable) = mt.defs
 next(mt::MethodTable, m::Method) = (m,m.next)
 done(mt::MethodTable, m::Method) = false
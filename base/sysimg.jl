@@ -226,6 +226,12 @@ importall .Profile
 
 include("precompile.jl")
 
+# extra code to compile into the system image, e.g. precompile statements
+# written by --trace-compile
+if isfile("userimg.jl")
+    include("userimg.jl")
+end
+
 include = include_from_node1
 
 # invoke type inference, running the existing inference code on the new
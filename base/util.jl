@@ -13,6 +13,36 @@ time_ns() = ccall(:jl_hrtime, Uint64, ())
 # total number of bytes allocated so far
 gc_bytes() = ccall(:jl_gc_total_bytes, Int64, ())
 
+# record of one garbage collection; matches jl_gc_event_t in julia.h
+immutable GCEvent
+    start::Float64
+    mark_time::Float64
+    sweep_time::Float64
+    finalize_time::Float64
+    allocd::Int64
+    freed::Int64
+    live::Int64
+    pages::Int64
+    pages_cached::Int64
+    nfinal::Int32
+    full::Int32
+end
+
+# records of the last n (at most 256) collections, oldest first
+function gc_stats(n::Integer=256)
+    a = Array(GCEvent, n)
+    m = ccall(:jl_gc_get_stats, Csize_t, (Ptr{GCEvent}, Csize_t), a, n)
+    resize!(a, m)
+end
+
+# append a JSON record of each collection to a file; nothing stops logging
+function gc_log(path::Union(String,Nothing))
+    p = path === nothing ? C_NULL : bytestring(path)
+    if ccall(:jl_gc_set_log_file, Cint, (Ptr{Uint8},), p) != 0
+        error("cannot open GC log file $path")
+    end
+end
+
 function tic()
     t0 = time_ns()
     task_local_storage(:TIMERS, (t0, get(task_local_storage(), :TIMERS, ())))
@@ -208,6 +208,7 @@ jl_value_t *jl_set_nth_field(jl_value_t *v, size_t i, jl_value_t *rhs)
     size_t offs = jl_field_offset(st,i) + sizeof(void*);
     if (st->fields[i].isptr) {
         *(jl_value_t**)((char*)v + offs) = rhs;
+        jl_gc_wb(v, rhs);
     }
     else {
         jl_assign_bits((char*)v + offs, rhs);
@@ -225,7 +226,10 @@ DLLEXPORT jl_value_t *jl_new_struct(jl_datatype_t *type, ...)
     for(size_t i=0; i < nf; i++) {
         jl_set_nth_field(jv, i, va_arg(args, jl_value_t*));
     }
-    if (type->size == 0) type->instance = jv;
+    if (type->size == 0) {
+        type->instance = jv;
+        jl_gc_wb(type, jv);
+    }
     va_end(args);
     return jv;
 }
@@ -242,7 +246,10 @@ DLLEXPORT jl_value_t *jl_new_structv(jl_datatype_t *type, jl_value_t **args, uin
         if (type->fields[i].isptr)
             *(jl_value_t**)((char*)jv+jl_field_offset(type,i)+sizeof(void*)) = NULL;
     }
-    if (type->size == 0) type->instance = jv;
+    if (type->size == 0) {
+        type->instance = jv;
+        jl_gc_wb(type, jv);
+    }
     return jv;
 }
 
@@ -250,8 +257,13 @@ DLLEXPORT jl_value_t *jl_new_struct_uninit(jl_datatype_t *type)
 {
     if (type->instance != NULL) return type->instance;
     jl_value_t *jv = newstruct(type);
-    if (type->size == 0) type->instance = jv;
-    else memset(&((void**)jv)[1], 0, type->size);
+    if (type->size == 0) {
+        type->instance = jv;
+        jl_gc_wb(type, jv);
+    }
+    else {
+        memset(&((void**)jv)[1], 0, type->size);
+    }
     return jv;
 }
 
@@ -387,6 +399,11 @@ jl_lambda_info_t *jl_new_lambda_info(jl_value_t *ast, jl_tuple_t *sparams)
     li->inferred = 0;
     li->inInference = 0;
     li->inCompile = 0;
+    li->quickCompiled = 0;
+    li->tierQueued = 0;
+    li->noVectorize = 0;
+    li->quickFptr = NULL;
+    li->tierCount = 0;
     li->unspecialized = NULL;
     li->specializations = NULL;
     li->name = anonymous_sym;
@@ -397,77 +414,141 @@ jl_lambda_info_t *jl_new_lambda_info(jl_value_t *ast, jl_tuple_t *sparams)
 
 // symbols --------------------------------------------------------------------
 
-static jl_sym_t *symtab = NULL;
+// symbols are interned in a chained hash table keyed by their precomputed
+// hash. they are never freed, so their storage is carved out of large
+// malloc'd blocks.
+static jl_sym_t **symtab = NULL;
+static size_t symtab_size = 0;   // number of buckets, a power of 2
+static size_t nsymbols = 0;
 
-static jl_sym_t *mk_symbol(const char *str)
+#define SYM_BLOCK_SIZE 65536
+static char *sym_pool = NULL;
+static size_t sym_pool_left = 0;
+
+static void *sym_alloc(size_t sz)
 {
-    jl_sym_t *sym;
-    size_t len = strlen(str);
+    sz = LLT_ALIGN(sz, sizeof(void*));
+    if (sz > SYM_BLOCK_SIZE/4)
+        return malloc(sz);
+    if (sz > sym_pool_left) {
+        sym_pool = (char*)malloc(SYM_BLOCK_SIZE);
+        sym_pool_left = SYM_BLOCK_SIZE;
+    }
+    void *p = sym_pool;
+    sym_pool += sz;
+    sym_pool_left -= sz;
+    return p;
+}
 
-    sym = (jl_sym_t*)malloc((sizeof(jl_sym_t)+len+1+7)&-8);
-    sym->type = (jl_value_t*)jl_sym_type;
-    sym->left = sym->right = NULL;
+static uptrint_t hash_symbol(const char *str, size_t len)
+{
 #ifdef _P64
-    sym->hash = memhash(str, len)^0xAAAAAAAAAAAAAAAAL;
+    return memhash(str, len)^0xAAAAAAAAAAAAAAAAL;
 #else
-    sym->hash = memhash32(str, len)^0xAAAAAAAA;
+    return memhash32(str, len)^0xAAAAAAAA;
 #endif
-    strcpy(&sym->name[0], str);
+}
+
+static jl_sym_t *mk_symbol(const char *str, size_t len, uptrint_t hash)
+{
+    jl_sym_t *sym;
+
+    sym = (jl_sym_t*)sym_alloc(sizeof(jl_sym_t)+len+1);
+    // symbols are never freed, so they start out in the old generation
+    sym->type = (jl_value_t*)((uptrint_t)jl_sym_type | GC_OLD);
+    sym->next = NULL;
+    sym->len = len;
+    sym->hash = hash;
+    memcpy(&sym->name[0], str, len);
+    sym->name[len] = '\0';
     return sym;
 }
 
-static void unmark_symbols_(jl_sym_t *root)
+DLLEXPORT void jl_foreach_symbol(void (*f)(jl_sym_t*, void*), void *ctx)
 {
-    while (root != NULL) {
-        root->type = (jl_value_t*)(((uptrint_t)root->type)&~1UL);
-        unmark_symbols_(root->left);
-        root = root->right;
+    for(size_t i=0; i < symtab_size; i++) {
+        for(jl_sym_t *s = symtab[i]; s != NULL; s = s->next)
+            f(s, ctx);
     }
 }
 
-void jl_unmark_symbols(void) { unmark_symbols_(symtab); }
+void jl_unmark_symbols(void)
+{
+    for(size_t i=0; i < symtab_size; i++) {
+        for(jl_sym_t *s = symtab[i]; s != NULL; s = s->next)
+            s->type = (jl_value_t*)(((uptrint_t)s->type)&~1UL);
+    }
+}
 
-static jl_sym_t **symtab_lookup(jl_sym_t **ptree, const char *str)
+static void symtab_grow(void)
 {
-    int x;
+    size_t newsz = symtab_size ? symtab_size*2 : 4096;
+    jl_sym_t **newtab = (jl_sym_t**)calloc(newsz, sizeof(jl_sym_t*));
+    for(size_t i=0; i < symtab_size; i++) {
+        jl_sym_t *s = symtab[i];
+        while (s != NULL) {
+            jl_sym_t *next = s->next;
+            jl_sym_t **bucket = &newtab[s->hash & (newsz-1)];
+            s->next = *bucket;
+            *bucket = s;
+            s = next;
+        }
+    }
+    free(symtab);
+    symtab = newtab;
+    symtab_size = newsz;
+}
 
-    while(*ptree != NULL) {
-        x = strcmp(str, (*ptree)->name);
-        if (x == 0)
-            return ptree;
-        if (x < 0)
-            ptree = &(*ptree)->left;
-        else
-            ptree = &(*ptree)->right;
+static jl_sym_t *symtab_lookup(const char *str, size_t len, uptrint_t hash)
+{
+    if (symtab_size == 0)
+        return NULL;
+    jl_sym_t *s = symtab[hash & (symtab_size-1)];
+    while (s != NULL) {
+        if (s->hash == hash && s->len == len &&
+            memcmp(str, s->name, len) == 0)
+            return s;
+        s = s->next;
     }
-    return ptree;
+    return NULL;
 }
 
-jl_sym_t *jl_symbol(const char *str)
+static jl_sym_t *symbol_n(const char *str, size_t len)
 {
-    jl_sym_t **pnode;
+    uptrint_t hash = hash_symbol(str, len);
+    jl_sym_t *s = symtab_lookup(str, len, hash);
+    if (s == NULL) {
+        if (nsymbols >= symtab_size)
+            symtab_grow();
+        s = mk_symbol(str, len, hash);
+        jl_sym_t **bucket = &symtab[hash & (symtab_size-1)];
+        s->next = *bucket;
+        *bucket = s;
+        nsymbols++;
+    }
+    return s;
+}
 
-    pnode = symtab_lookup(&symtab, str);
-    if (*pnode == NULL)
-        *pnode = mk_symbol(str);
-    return *pnode;
+jl_sym_t *jl_symbol(const char *str)
+{
+    return symbol_n(str, strlen(str));
 }
 
 jl_sym_t *jl_symbol_lookup(const char *str)
 {
-    return *symtab_lookup(&symtab, str);
+    size_t len = strlen(str);
+    return symtab_lookup(str, len, hash_symbol(str, len));
 }
 
 DLLEXPORT jl_sym_t *jl_symbol_n(const char *str, int32_t len)
 {
-    char name[len+1];
-    memcpy(name, str, len);
-    name[len] = '\0';
-    return jl_symbol(name);
+    // the name ends at the first NUL, as with jl_symbol
+    const char *z = (const char*)memchr(str, '\0', len);
+    if (z != NULL)
+        len = z - str;
+    return symbol_n(str, len);
 }
 
-DLLEXPORT jl_sym_t *jl_get_root_symbol() { return symtab; }
-
 static uint32_t gs_ctr = 0;  // TODO: per-thread
 uint32_t jl_get_gs_ctr(void) { return gs_ctr; }
 void jl_set_gs_ctr(uint32_t ctr) { gs_ctr = ctr; }
@@ -499,11 +580,12 @@ DLLEXPORT jl_sym_t *jl_tagged_gensym(const char* str, int32_t len)
 
 jl_typename_t *jl_new_typename(jl_sym_t *name)
 {
-    jl_typename_t *tn=(jl_typename_t*)newobj((jl_value_t*)jl_typename_type, 4);
+    jl_typename_t *tn=(jl_typename_t*)newobj((jl_value_t*)jl_typename_type, 5);
     tn->name = name;
     tn->module = jl_current_module;
     tn->primary = NULL;
     tn->cache = (jl_value_t*)jl_null;
+    tn->linearcache = (jl_value_t*)jl_null;
     return tn;
 }
 
@@ -550,6 +632,7 @@ void jl_add_constructors(jl_datatype_t *t)
                                              sparams);
             cfactory->linfo->ast = jl_prepare_ast(cfactory->linfo,
                                                   cfactory->linfo->sparams);
+            jl_gc_wb(cfactory->linfo, cfactory->linfo->ast);
             
             // call user-defined constructor factory on (type,)
             jl_value_t *cfargs[1] = { (jl_value_t*)t };
@@ -567,16 +650,18 @@ JL_CALLABLE(jl_f_ctor_trampoline)
 
 jl_datatype_t *jl_new_uninitialized_datatype(size_t nfields)
 {
-    return (jl_datatype_t*)
+    jl_datatype_t *t = (jl_datatype_t*)
         newobj((jl_value_t*)jl_datatype_type,
                NWORDS(sizeof(jl_datatype_t) - sizeof(void*) +
                       nfields*sizeof(jl_fielddesc_t)));
+    t->haspadding = 1;
+    return t;
 }
 
 void jl_compute_field_offsets(jl_datatype_t *st)
 {
     size_t sz = 0, alignm = 0;
-    int ptrfree = 1;
+    int ptrfree = 1, haspadding = 0;
 
     for(size_t i=0; i < jl_tuple_len(st->types); i++) {
         jl_value_t *ty = jl_tupleref(st->types, i);
@@ -592,6 +677,8 @@ void jl_compute_field_offsets(jl_datatype_t *st)
             st->fields[i].isptr = 1;
             ptrfree = 0;
         }
+        if (LLT_ALIGN(sz, al) != sz)
+            haspadding = 1;
         sz = LLT_ALIGN(sz, al);
         if (al > alignm)
             alignm = al;
@@ -601,6 +688,7 @@ void jl_compute_field_offsets(jl_datatype_t *st)
     }
     st->alignment = alignm;
     st->size = LLT_ALIGN(sz, alignm);
+    st->haspadding = haspadding || st->size != sz;
     st->pointerfree = ptrfree && !st->abstract;
 }
 
@@ -487,6 +487,7 @@ void jl_arrayset(jl_array_t *a, jl_value_t *rhs, size_t i)
     }
     else {
         ((jl_value_t**)a->data)[i] = rhs;
+        jl_gc_wb(a, rhs);
     }
 }
 
@@ -539,6 +540,8 @@ static void array_resize_buffer(jl_array_t *a, size_t newlen, size_t oldlen, siz
         else {
             newdata = allocb(nbytes);
             a->how = 1;
+            // an old array now refers to a young buffer
+            jl_gc_wb_back(a);
         }
         memcpy(newdata + offsnb, (char*)a->data, oldnbytes);
     }
@@ -31,6 +31,7 @@ JL_CALLABLE(jl_f_instantiate_type);
 JL_CALLABLE(jl_f_convert_default);
 JL_CALLABLE(jl_f_convert_tuple);
 JL_CALLABLE(jl_trampoline);
+JL_CALLABLE(jl_tier_trampoline);
 JL_CALLABLE(jl_f_new_type_constructor);
 JL_CALLABLE(jl_f_typevar);
 JL_CALLABLE(jl_f_union);
@@ -156,6 +156,10 @@ int jl_egal(jl_value_t *a, jl_value_t *b)
     if (nf == 0) {
         return bits_equal(jl_data_ptr(a), jl_data_ptr(b), sz);
     }
+    if (dt->pointerfree && !dt->haspadding) {
+        // the fields cover the data, so compare it in one pass
+        return bits_equal(jl_data_ptr(a), jl_data_ptr(b), sz);
+    }
     for (size_t f=0; f < nf; f++) {
         size_t offs = dt->fields[f].offset;
         char *ao = (char*)jl_data_ptr(a) + offs;
@@ -710,6 +714,7 @@ JL_CALLABLE(jl_trampoline)
         if (!jl_in_inference) {
             if (!jl_is_expr(f->linfo->ast)) {
                 f->linfo->ast = jl_uncompress_ast(f->linfo, f->linfo->ast);
+                jl_gc_wb(f->linfo, f->linfo->ast);
             }
             if (jl_eval_with_compiler_p(jl_lam_body((jl_expr_t*)f->linfo->ast),1)) {
                 jl_type_infer(f->linfo, jl_tuple_type, f->linfo);
@@ -721,10 +726,102 @@ JL_CALLABLE(jl_trampoline)
     jl_generate_fptr(f);
     if (jl_boot_file_loaded && jl_is_expr(f->linfo->ast)) {
         f->linfo->ast = jl_compress_ast(f->linfo, f->linfo->ast);
+        jl_gc_wb(f->linfo, f->linfo->ast);
     }
     return jl_apply(f, args, nargs);
 }
 
+DLLEXPORT int jl_tier_threshold = 0;
+
+DLLEXPORT void jl_set_tiered_compilation(int threshold)
+{
+    jl_tier_threshold = threshold > 0 ? threshold : 0;
+}
+
+// whether li is currently running its quick-compiled code
+DLLEXPORT int jl_is_quick_compiled(jl_lambda_info_t *li)
+{
+    return li->quickCompiled;
+}
+
+// calls and loop iterations counted towards the tier threshold
+DLLEXPORT int32_t jl_tier_count(jl_lambda_info_t *li)
+{
+    return li->tierCount;
+}
+
+// with async compilation, functions that reach the threshold are queued, and
+// optimized by the scheduler while it has no runnable tasks (see multi.jl).
+// a function that stays hot before that happens, reaching twice the
+// threshold, is optimized right away.
+static int tier_async = 0;
+jl_array_t *jl_tier_queue = NULL;
+
+DLLEXPORT void jl_set_async_compilation(int on)
+{
+    tier_async = on;
+}
+
+static void tier_enqueue(jl_lambda_info_t *li)
+{
+    if (li->tierQueued)
+        return;
+    if (jl_tier_queue == NULL)
+        jl_tier_queue = jl_alloc_cell_1d(0);
+    jl_cell_1d_push(jl_tier_queue, (jl_value_t*)li);
+    li->tierQueued = 1;
+}
+
+// optimize up to n queued functions. returns the number optimized.
+DLLEXPORT int jl_tier_run_queue(int n)
+{
+    int done = 0;
+    jl_lambda_info_t *li = NULL;
+    JL_GC_PUSH1(&li);
+    while (done < n && jl_tier_queue != NULL && jl_array_len(jl_tier_queue) > 0) {
+        size_t last = jl_array_len(jl_tier_queue)-1;
+        li = (jl_lambda_info_t*)jl_cellref(jl_tier_queue, last);
+        jl_array_del_end(jl_tier_queue, 1);
+        li->tierQueued = 0;
+        if (li->quickCompiled && li->fptr == &jl_tier_trampoline) {
+            jl_tier_up(li);
+            done++;
+        }
+    }
+    JL_GC_POP();
+    return done;
+}
+
+// entry point of quick-compiled functions under tiered compilation. counts
+// calls, and switches to fully optimized code once the function has run
+// jl_tier_threshold calls or loop iterations.
+JL_CALLABLE(jl_tier_trampoline)
+{
+    jl_function_t *f = (jl_function_t*)F;
+    jl_lambda_info_t *li = f->linfo;
+    if (li->fptr == &jl_tier_trampoline) {
+        if (!li->quickCompiled) {
+            jl_tier_up(li);
+        }
+        else {
+            // loops in quick code count too, and stop at INT32_MAX
+            if (li->tierCount < INT32_MAX)
+                li->tierCount++;
+            if (li->tierCount >= jl_tier_threshold) {
+                if (tier_async && li->tierCount < 2*(int64_t)jl_tier_threshold)
+                    tier_enqueue(li);
+                else
+                    jl_tier_up(li);
+            }
+        }
+    }
+    if (li->fptr != &jl_tier_trampoline) {
+        f->fptr = li->fptr;
+        return li->fptr(F, args, nargs);
+    }
+    return li->quickFptr(F, args, nargs);
+}
+
 JL_CALLABLE(jl_f_instantiate_type)
 {
     JL_NARGSV(instantiate_type, 1);
@@ -894,7 +991,7 @@ DLLEXPORT uptrint_t jl_object_id(jl_value_t *v)
     uptrint_t h = inthash((uptrint_t)tv);
     if (sz == 0) return ~h;
     size_t nf = jl_tuple_len(dt->names);
-    if (nf == 0) {
+    if (nf == 0 || (dt->pointerfree && !dt->haspadding)) {
         return bits_hash(jl_data_ptr(v), sz) ^ h;
     }
     for (size_t f=0; f < nf; f++) {
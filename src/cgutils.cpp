@@ -328,7 +328,7 @@ static jl_value_t *llvm_type_to_julia(Type *t, bool throw_error)
     if (t == T_float32) return (jl_value_t*)jl_float32_type;
     if (t == T_float64) return (jl_value_t*)jl_float64_type;
     if (t == T_void) return (jl_value_t*)jl_bottom_type;
-    if (t->isEmptyTy()) return (jl_value_t*)jl_nothing->type;
+    if (t->isEmptyTy()) return jl_typeof(jl_nothing);
     if (t == jl_pvalue_llvmt)
         return (jl_value_t*)jl_any_type;
     if (t->isPointerTy()) {
@@ -348,19 +348,20 @@ static jl_value_t *llvm_type_to_julia(Type *t, bool throw_error)
 // --- scheme for tagging llvm values with julia types using metadata ---
 
 static std::map<int, jl_value_t*> typeIdToType;
-static jl_array_t *typeToTypeId;
+static jl_array_t *typeToTypeId;  // cell holding the id table, which moves as it grows
 static int cur_type_id = 1;
 
 static int jl_type_to_typeid(jl_value_t *t)
 {
-    jl_value_t *id = jl_eqtable_get(typeToTypeId, t, NULL);
+    jl_value_t *id = jl_eqtable_get((jl_array_t*)jl_cellref(typeToTypeId, 0), t, NULL);
     if (id == NULL) {
         int mine = cur_type_id++;
         if (mine > 65025)
             jl_error("internal compiler error: too many bits types");
         JL_GC_PUSH1(&id);
         id = jl_box_long(mine);
-        jl_eqtable_put(typeToTypeId, t, id);
+        jl_cellset(typeToTypeId, 0,
+                   jl_eqtable_put((jl_array_t*)jl_cellref(typeToTypeId, 0), t, id));
         typeIdToType[mine] = t;
         JL_GC_POP();
         return mine;
@@ -452,11 +453,18 @@ static Value *emit_typeof(Value *p)
         tt = builder.
             CreateLoad(builder.CreateGEP(tt,ConstantInt::get(T_size,0)),
                        false);
+        // strip the gc bits (and the tuple length, with OVERLAP_TUPLE_LEN)
 #ifdef OVERLAP_TUPLE_LEN
         tt = builder.
             CreateIntToPtr(builder.
                            CreateAnd(builder.CreatePtrToInt(tt, T_int64),
-                                     ConstantInt::get(T_int64,0x000ffffffffffffe)),
+                                     ConstantInt::get(T_int64,0x000ffffffffffffc)),
+                           jl_pvalue_llvmt);
+#else
+        tt = builder.
+            CreateIntToPtr(builder.
+                           CreateAnd(builder.CreatePtrToInt(tt, T_size),
+                                     ConstantInt::get(T_size,~(uptrint_t)3)),
                            jl_pvalue_llvmt);
 #endif
         return tt;
@@ -646,18 +654,54 @@ static Value *typed_load(Value *ptr, Value *idx_0based, jl_value_t *jltype,
 
 static Value *emit_unbox(Type *to, Value *x, jl_value_t *jt);
 
+// generational write barrier for storing the boxed value `ptr` into the
+// object `parent`. same test as jl_gc_wb in julia.h.
+static void emit_write_barrier(jl_codectx_t *ctx, Value *parent, Value *ptr)
+{
+    Value *parenttag = builder.CreateLoad(builder.CreateBitCast(parent, T_psize), false);
+    Value *parentold =
+        builder.CreateICmpEQ(builder.CreateAnd(parenttag, ConstantInt::get(T_size, GC_BITS_MASK)),
+                             ConstantInt::get(T_size, GC_OLD));
+    BasicBlock *checkptr = BasicBlock::Create(getGlobalContext(), "wb_checkptr", ctx->f);
+    BasicBlock *checkage = BasicBlock::Create(getGlobalContext(), "wb_checkage", ctx->f);
+    BasicBlock *queue = BasicBlock::Create(getGlobalContext(), "wb_queue", ctx->f);
+    BasicBlock *cont = BasicBlock::Create(getGlobalContext(), "wb_cont", ctx->f);
+    builder.CreateCondBr(parentold, checkptr, cont);
+    builder.SetInsertPoint(checkptr);
+    builder.CreateCondBr(builder.CreateICmpNE(ptr, V_null), checkage, cont);
+    builder.SetInsertPoint(checkage);
+    Value *ptrtag = builder.CreateLoad(builder.CreateBitCast(ptr, T_psize), false);
+    Value *ptryoung =
+        builder.CreateICmpEQ(builder.CreateAnd(ptrtag, ConstantInt::get(T_size, GC_OLD)),
+                             ConstantInt::get(T_size, 0));
+    builder.CreateCondBr(ptryoung, queue, cont);
+    builder.SetInsertPoint(queue);
+    builder.CreateCall(jlqueueroot_func, parent);
+    builder.CreateBr(cont);
+    builder.SetInsertPoint(cont);
+}
+
+// `parent` is the object containing ptr, if the store needs a write barrier
 static Value *typed_store(Value *ptr, Value *idx_0based, Value *rhs,
-                          jl_value_t *jltype, jl_codectx_t *ctx)
+                          jl_value_t *jltype, jl_codectx_t *ctx,
+                          Value *parent = NULL)
 {
     Type *elty = julia_type_to_llvm(jltype);
     assert(elty != NULL);
     if (elty==T_int1) { elty = T_int8; }
-    if (jl_isbits(jltype) && ((jl_datatype_t*)jltype)->size > 0)
+    bool isboxed = false;
+    if (jl_isbits(jltype) && ((jl_datatype_t*)jltype)->size > 0) {
         rhs = emit_unbox(elty, rhs, jltype);
-    else
+    }
+    else {
         rhs = boxed(rhs,ctx);
+        isboxed = true;
+    }
     Value *data = builder.CreateBitCast(ptr, PointerType::get(elty, 0));
-    return builder.CreateStore(rhs, builder.CreateGEP(data, idx_0based));
+    Value *store = builder.CreateStore(rhs, builder.CreateGEP(data, idx_0based));
+    if (isboxed && parent != NULL)
+        emit_write_barrier(ctx, parent, rhs);
+    return store;
 }
 
 // --- convert boolean value to julia ---
@@ -1070,16 +1114,34 @@ static Value *emit_array_nd_index(Value *a, jl_value_t *ex, size_t nd, jl_value_
         failBB = BasicBlock::Create(getGlobalContext(), "oob");
         endBB = BasicBlock::Create(getGlobalContext(), "idxend");
     }
+    // the final check against the length is redundant if every index is
+    // known to be within its dimension, or a single index within the length
+    bool allinbounds = true;
 #endif
     for(size_t k=0; k < nidxs; k++) {
         Value *ii = emit_unbox(T_size, emit_unboxed(args[k], ctx), NULL);
         ii = builder.CreateSub(ii, ConstantInt::get(T_size, 1));
         i = builder.CreateAdd(i, builder.CreateMul(ii, stride));
+#if CHECK_BOUNDS==1
+        bool inbounds = false;
+        if (bc) {
+            if (nidxs == 1)
+                inbounds = index_in_bounds(ex, args[k], 0, ctx);
+            else if (k < nd)
+                inbounds = index_in_bounds(ex, args[k], k+1, ctx);
+            allinbounds &= inbounds;
+        }
+#endif
         if (k < nidxs-1) {
             Value *d =
                 k >= nd ? ConstantInt::get(T_size, 1) : emit_arraysize(a, ex, k+1, ctx);
 #if CHECK_BOUNDS==1
             if (bc) {
+                ctx->nBoundsChecks++;
+                if (inbounds)
+                    ctx->nBoundsElided++;
+            }
+            if (bc && !inbounds) {
                 BasicBlock *okBB = BasicBlock::Create(getGlobalContext(), "ib");
                 // if !(i < d) goto error
                 builder.CreateCondBr(builder.CreateICmpULT(ii, d), okBB, failBB);
@@ -1091,6 +1153,16 @@ static Value *emit_array_nd_index(Value *a, jl_value_t *ex, size_t nd, jl_value_
         }
     }
 #if CHECK_BOUNDS==1
+    if (bc) {
+        ctx->nBoundsChecks++;
+        if (allinbounds && (nidxs == 1 || nidxs == nd)) {
+            ctx->nBoundsElided++;
+            bc = false;
+            // nothing jumps to the error block
+            delete failBB;
+            delete endBB;
+        }
+    }
     if (bc) {
         Value *alen = emit_arraylen(a, ex, ctx);
         // if !(i < alen) goto error
@@ -1121,6 +1193,42 @@ static Value *tpropagate(Value *a, Value *b)
 
 // --- boxing ---
 
+// allocate an object of nbytes bytes, whose type tag the caller stores
+// right away. small objects are allocated inline by bumping the pointer
+// of their pool (see pool_alloc in gc.c), falling back to allocobj.
+static Value *emit_allocobj(size_t nbytes)
+{
+#ifdef JL_GC_MARKSWEEP
+    size_t osize;
+    int pool = jl_gc_pool_index(nbytes, &osize);
+    if (pool >= 0) {
+        Function *f = builder.GetInsertBlock()->getParent();
+        Value *pcur = builder.CreateConstGEP1_32(jlgcbump_var, 2*pool);
+        Value *pend = builder.CreateConstGEP1_32(jlgcbump_var, 2*pool+1);
+        Value *cur = builder.CreateLoad(pcur);
+        Value *next = builder.CreateConstGEP1_32(cur, osize);
+        Value *fits = builder.CreateICmpULE(next, builder.CreateLoad(pend));
+        BasicBlock *fastBB = BasicBlock::Create(getGlobalContext(), "alloc_bump", f);
+        BasicBlock *slowBB = BasicBlock::Create(getGlobalContext(), "alloc_call", f);
+        BasicBlock *doneBB = BasicBlock::Create(getGlobalContext(), "alloc_done", f);
+        builder.CreateCondBr(fits, fastBB, slowBB);
+        builder.SetInsertPoint(fastBB);
+        builder.CreateStore(next, pcur);
+        Value *fastv = builder.CreateBitCast(cur, jl_pvalue_llvmt);
+        builder.CreateBr(doneBB);
+        builder.SetInsertPoint(slowBB);
+        Value *slowv = builder.CreateCall(jlallocobj_func, ConstantInt::get(T_size, nbytes));
+        builder.CreateBr(doneBB);
+        builder.SetInsertPoint(doneBB);
+        PHINode *newv = builder.CreatePHI(jl_pvalue_llvmt, 2);
+        newv->addIncoming(fastv, fastBB);
+        newv->addIncoming(slowv, slowBB);
+        return newv;
+    }
+#endif
+    return builder.CreateCall(jlallocobj_func, ConstantInt::get(T_size, nbytes));
+}
+
 static Value *init_bits_value(Value *newv, Value *jt, Type *t, Value *v)
 {
     builder.CreateStore(jt, builder.CreateBitCast(newv, jl_ppvalue_llvmt));
@@ -1136,8 +1244,7 @@ static Value *allocate_box_dynamic(Value *jlty, int nb, Value *v)
         v = builder.CreatePtrToInt(v, T_size);
     }
     size_t sz = sizeof(void*) + nb;
-    Value *newv = builder.CreateCall(jlallocobj_func,
-                                     ConstantInt::get(T_size, sz));
+    Value *newv = emit_allocobj(sz);
     // TODO: make sure this is rooted. I think it is.
     return init_bits_value(newv, jlty, v->getType(), v);
 }
@@ -1274,11 +1381,7 @@ static Value *boxed(Value *v,  jl_codectx_t *ctx, jl_value_t *jt)
     //if (jb == jl_float64_type) return builder.CreateCall(box_float64_func, v);
     if (jb == jl_float64_type) {
         // manually inline alloc & init of Float64 box. cheap, I know.
-#ifdef _P64
-        Value *newv = builder.CreateCall(jlalloc2w_func);
-#else
-        Value *newv = builder.CreateCall(jlalloc3w_func);
-#endif
+        Value *newv = emit_allocobj(sizeof(void*) + sizeof(double));
         return init_bits_value(newv, literal_pointer_val(jt), t, v);
     }
     if (jb == jl_uint8_type)
@@ -63,6 +63,7 @@
 #include "llvm/Support/IRBuilder.h"
 #endif
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 1
@@ -120,6 +121,18 @@ static ExecutionEngine *jl_ExecutionEngine;
 static DIBuilder *dbuilder;
 static std::map<int, std::string> argNumberStrings;
 static FunctionPassManager *FPM;
+// the full pipeline without the vectorizers, for functions that opt out
+static FunctionPassManager *NoVecFPM;
+// a short pass list for the first tier of tiered compilation
+static FunctionPassManager *QuickFPM;
+#ifdef LLVM33
+static TargetMachine *jl_TargetMachine;  // for the vectorizers' cost models
+#endif
+static bool quick_compile = false;    // emitting code for the quick tier
+// print how many array bounds checks each function needs and how many of
+// them were removed; set with JULIA_BOUNDSCHECK_REPORT=1
+static bool report_bounds_elision = false;
+static bool tier_force_full = false;  // inside jl_tier_up
 
 #ifdef LLVM32
 static DataLayout *jl_data_layout;
@@ -168,7 +181,9 @@ static GlobalVariable *jlnull_var;
 static GlobalVariable *jlfloattemp_var;
 #ifdef JL_GC_MARKSWEEP
 static GlobalVariable *jlpgcstack_var;
+static GlobalVariable *jlgcbump_var;
 #endif
+static GlobalVariable *jlicepoch_var;
 static GlobalVariable *jlexc_var;
 static GlobalVariable *jldiverr_var;
 static GlobalVariable *jlundeferr_var;
@@ -191,11 +206,13 @@ static Function *jlerror_func;
 static Function *jltypeerror_func;
 static Function *jlcheckassign_func;
 static Function *jldeclareconst_func;
+static Function *jlqueueroot_func;
 static Function *jltopeval_func;
 static Function *jlcopyast_func;
 static Function *jltuple_func;
 static Function *jlntuple_func;
 static Function *jlapplygeneric_func;
+static Function *jlapplygenericic_func;
 static Function *jlgetfield_func;
 static Function *jlbox_func;
 static Function *jlclosure_func;
@@ -262,6 +279,8 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
     DebugLoc olddl = builder.getCurrentDebugLocation();
     bool last_n_c = nested_compile;
     nested_compile = true;
+    bool last_quick = quick_compile;
+    quick_compile = !cstyle && jl_tier_threshold > 0 && !imaging_mode && !tier_force_full;
     Function *f = NULL;
     JL_TRY {
         f = emit_function(li, cstyle);
@@ -272,6 +291,7 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
         li->functionObject = NULL;
         li->cFunctionObject = NULL;
         nested_compile = last_n_c;
+        quick_compile = last_quick;
         if (old != NULL) {
             builder.SetInsertPoint(old);
             builder.SetCurrentDebugLocation(olddl);
@@ -285,7 +305,15 @@ static Function *to_function(jl_lambda_info_t *li, bool cstyle)
 #ifdef DEBUG
     verifyFunction(*f);
 #endif
-    FPM->run(*f);
+    if (quick_compile)
+        QuickFPM->run(*f);
+    else if (li->def->noVectorize)
+        NoVecFPM->run(*f);
+    else
+        FPM->run(*f);
+    if (!cstyle)
+        li->quickCompiled = quick_compile;
+    quick_compile = last_quick;
     //n_compile++;
     // print out the function's LLVM code
     //ios_printf(ios_stderr, "%s:%d\n",
@@ -310,7 +338,14 @@ extern "C" void jl_generate_fptr(jl_function_t *f)
     Function *llvmf = (Function*)li->functionObject;
     if (li->fptr == &jl_trampoline) {
         JL_SIGATOMIC_BEGIN();
-        li->fptr = (jl_fptr_t)jl_ExecutionEngine->getPointerToFunction(llvmf);
+        jl_fptr_t fptr = (jl_fptr_t)jl_ExecutionEngine->getPointerToFunction(llvmf);
+        if (li->quickCompiled) {
+            li->quickFptr = fptr;
+            li->fptr = &jl_tier_trampoline;
+        }
+        else {
+            li->fptr = fptr;
+        }
         if (li->cFunctionObject != NULL)
             (void)jl_ExecutionEngine->getPointerToFunction((Function*)li->cFunctionObject);
         JL_SIGATOMIC_END();
@@ -323,6 +358,41 @@ extern "C" void jl_generate_fptr(jl_function_t *f)
     f->fptr = li->fptr;
 }
 
+// while recording, the lambda infos compiled for specific argument types,
+// so that they can be precompiled into a system image
+extern "C" jl_array_t *jl_compile_log;
+jl_array_t *jl_compile_log = NULL;
+
+extern "C" DLLEXPORT void jl_start_compile_log(void)
+{
+    jl_compile_log = jl_alloc_cell_1d(0);
+}
+
+extern "C" DLLEXPORT jl_value_t *jl_stop_compile_log(void)
+{
+    jl_array_t *log = jl_compile_log;
+    jl_compile_log = NULL;
+    return log != NULL ? (jl_value_t*)log : (jl_value_t*)jl_alloc_cell_1d(0);
+}
+
+// vectorize loops and straight-line code; see add_optimization_passes.
+// off unless --vectorize=yes, since the vectorizers and their target
+// analyses add to the time of every full compile
+extern "C" int jl_vectorize_enabled;
+int jl_vectorize_enabled = 0;
+
+extern "C" DLLEXPORT void jl_set_vectorize_default(int on)
+{
+    jl_vectorize_enabled = on;
+}
+
+// opt a function definition out of (or back into) vectorization. this
+// applies to code compiled from now on.
+extern "C" DLLEXPORT void jl_set_vectorize(jl_lambda_info_t *li, int on)
+{
+    li->def->noVectorize = !on;
+}
+
 extern "C" void jl_compile(jl_function_t *f)
 {
     jl_lambda_info_t *li = f->linfo;
@@ -331,7 +401,55 @@ extern "C" void jl_compile(jl_function_t *f)
         li->inCompile = 1;
         (void)to_function(li, false);
         li->inCompile = 0;
+        if (jl_compile_log != NULL && li->specTypes != NULL)
+            jl_cell_1d_push(jl_compile_log, (jl_value_t*)li);
+    }
+}
+
+// recompile a quick-compiled function with the full optimization pipeline.
+// code for the new version is generated once no other compile is running;
+// until then, and if optimizing fails, the quick code keeps running.
+extern "C" void jl_tier_up(jl_lambda_info_t *li)
+{
+    if (li->quickCompiled) {
+        if (li->inCompile || li->inInference)
+            return;
+        void *oldf = li->functionObject;
+        void *oldcf = li->cFunctionObject;
+        li->quickCompiled = 0;
+        li->functionObject = NULL;
+        li->cFunctionObject = NULL;
+        bool last_full = tier_force_full;
+        tier_force_full = true;
+        li->inCompile = 1;
+        bool ok = true;
+        JL_TRY {
+            (void)to_function(li, false);
+        }
+        JL_CATCH {
+            ok = false;
+        }
+        li->inCompile = 0;
+        tier_force_full = last_full;
+        if (!ok) {
+            li->functionObject = oldf;
+            li->cFunctionObject = oldcf;
+            li->fptr = li->quickFptr;
+            return;
+        }
     }
+    if (nested_compile || li->fptr != &jl_tier_trampoline)
+        return;
+    Function *llvmf = (Function*)li->functionObject;
+    JL_SIGATOMIC_BEGIN();
+    jl_fptr_t fptr = (jl_fptr_t)jl_ExecutionEngine->getPointerToFunction(llvmf);
+    if (li->cFunctionObject != NULL)
+        (void)jl_ExecutionEngine->getPointerToFunction((Function*)li->cFunctionObject);
+    JL_SIGATOMIC_END();
+    llvmf->deleteBody();
+    if (li->cFunctionObject != NULL)
+        ((Function*)li->cFunctionObject)->deleteBody();
+    li->fptr = fptr;
 }
 
 void jl_cstyle_compile(jl_function_t *f)
@@ -365,7 +483,7 @@ void *jl_function_ptr(jl_function_t *f, jl_value_t *rt, jl_value_t *argt)
                               li->name->name);
                 }
                 if (!jl_types_equal(astrt, rt) &&
-                    !(astrt==(jl_value_t*)jl_nothing->type && rt==(jl_value_t*)jl_bottom_type)) {
+                    !(astrt==jl_typeof(jl_nothing) && rt==(jl_value_t*)jl_bottom_type)) {
                     if (astrt == (jl_value_t*)jl_bottom_type) {
                         jl_errorf("cfunction: %s does not return", li->name->name);
                     }
@@ -500,6 +618,17 @@ typedef struct {
     jl_value_t *ty;
 } jl_arrayvar_t;
 
+// the values a loop variable takes in the body of a loop
+// `for var = lo:hi`, where hi is the length (dim == 0) or a dimension of an
+// array, plus offs. holds in statements first < i <= last.
+typedef struct {
+    size_t first, last;
+    int64_t lo;
+    jl_sym_t *array;
+    int dim;
+    int64_t offs;
+} jl_looprange_t;
+
 // information about the context of a piece of code: its enclosing
 // function and module, and visible local variables and labels.
 typedef struct {
@@ -509,6 +638,7 @@ typedef struct {
     // a local, since otherwise this will add it to the map.
     std::map<jl_sym_t*, jl_varinfo_t> vars;
     std::map<jl_sym_t*, jl_arrayvar_t> *arrayvars;
+    std::map<jl_sym_t*, std::vector<jl_looprange_t> > *loopranges;
     std::map<int, BasicBlock*> *labels;
     std::map<int, Value*> *handlers;
     jl_module_t *module;
@@ -528,6 +658,9 @@ typedef struct {
     int nReqArgs;
     int lineno;
     std::vector<bool> boundsCheck;
+    size_t stmt;            // index of the body statement being compiled
+    int nBoundsChecks;      // array bounds checks needed...
+    int nBoundsElided;      // ...and how many of them were proven redundant
 #ifdef JL_GC_MARKSWEEP
     Instruction *gcframe ;
     Instruction *argSpaceInits;
@@ -549,6 +682,7 @@ static Value *global_binding_pointer(jl_module_t *m, jl_sym_t *s,
 static Value *emit_checked_var(Value *bp, jl_sym_t *name, jl_codectx_t *ctx);
 static bool might_need_root(jl_value_t *ex);
 static Value *emit_condition(jl_value_t *cond, const std::string &msg, jl_codectx_t *ctx);
+static bool index_in_bounds(jl_value_t *a, jl_value_t *idx, int dim, jl_codectx_t *ctx);
 
 // --- utilities ---
 
@@ -773,6 +907,287 @@ static void mark_volatile_vars(jl_array_t *stmts, std::map<jl_sym_t*,jl_varinfo_
     }
 }
 
+// --- bounds check elimination ---
+
+// finds loops `for v = lo:hi` over an array's indices, e.g.
+// `for i = 1:length(A)` or `for i = 2:size(A,1)-1`, so that array accesses
+// indexed by v (plus a constant) can skip their bounds checks. this relies
+// on the form the front end lowers ranged for loops to:
+//
+//     cnt = lo; lim = hi
+//     top: gotoifnot (cnt <= lim) end
+//         v = cnt
+//         body
+//         cnt = cnt + 1; goto top
+//     end:
+//
+// where cnt and lim are gensyms that the body cannot refer to.
+
+static jl_sym_t *local_var_sym(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (jl_is_symbolnode(e))
+        e = (jl_value_t*)jl_symbolnode_sym(e);
+    if (!jl_is_symbol(e) || ctx->vars.find((jl_sym_t*)e) == ctx->vars.end())
+        return NULL;
+    return (jl_sym_t*)e;
+}
+
+// the callee of e, if e is a call to a known function
+static jl_value_t *static_callee(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(e))
+        return NULL;
+    jl_expr_t *ex = (jl_expr_t*)e;
+    if ((ex->head != call_sym && ex->head != call1_sym) || jl_array_len(ex->args) == 0)
+        return NULL;
+    return static_eval(jl_exprarg(ex,0), ctx, true, false);
+}
+
+static bool is_intrinsic_call(jl_value_t *e, intrinsic f, size_t nargs, jl_codectx_t *ctx)
+{
+    jl_value_t *fv = static_callee(e, ctx);
+    return fv != NULL && jl_typeis(fv, jl_intrinsic_type) &&
+        (intrinsic)jl_unbox_int32(fv) == f &&
+        jl_array_len(((jl_expr_t*)e)->args) == nargs+1;
+}
+
+static bool is_builtin_call(jl_value_t *e, jl_fptr_t fptr, size_t nargs, jl_codectx_t *ctx)
+{
+    jl_value_t *fv = static_callee(e, ctx);
+    return fv != NULL && jl_is_func(fv) && ((jl_function_t*)fv)->fptr == fptr &&
+        jl_array_len(((jl_expr_t*)e)->args) == nargs+1;
+}
+
+// an integer constant small enough that sums of a few of them cannot overflow
+static bool is_small_int(jl_value_t *v)
+{
+    return jl_is_long(v) && jl_unbox_long(v) > -(1<<30) && jl_unbox_long(v) < (1<<30);
+}
+
+// split an integer expression into base + offs, for a constant offs
+static jl_value_t *split_offset(jl_value_t *e, int64_t *offs, jl_codectx_t *ctx)
+{
+    *offs = 0;
+    if (is_intrinsic_call(e, box, 2, ctx))
+        e = jl_exprarg(e,2);
+    if (is_intrinsic_call(e, add_int, 2, ctx)) {
+        jl_value_t *a = jl_exprarg(e,1), *b = jl_exprarg(e,2);
+        if (is_small_int(b)) {
+            *offs = jl_unbox_long(b);
+            return a;
+        }
+        if (is_small_int(a)) {
+            *offs = jl_unbox_long(a);
+            return b;
+        }
+    }
+    else if (is_intrinsic_call(e, sub_int, 2, ctx) && is_small_int(jl_exprarg(e,2))) {
+        *offs = -jl_unbox_long(jl_exprarg(e,2));
+        return jl_exprarg(e,1);
+    }
+    return e;
+}
+
+static bool is_gensym_var(jl_sym_t *s, jl_codectx_t *ctx)
+{
+    if (s == NULL || s->name[0] != '#')
+        return false;
+    jl_varinfo_t &vi = ctx->vars[s];
+    return !vi.isCaptured && !vi.isArgument && vi.declType == (jl_value_t*)jl_long_type;
+}
+
+// whether e might change the size of an array: anything but intrinsics and
+// builtins that do not call back into julia
+static bool may_resize_arrays(jl_value_t *e, jl_codectx_t *ctx)
+{
+    if (!jl_is_expr(e))
+        return false;
+    jl_expr_t *ex = (jl_expr_t*)e;
+    size_t i, first = 0;
+    if (ex->head == call_sym || ex->head == call1_sym) {
+        jl_value_t *fv = static_callee(e, ctx);
+        if (fv == NULL)
+            return true;
+        if (jl_typeis(fv, jl_intrinsic_type)) {
+            intrinsic fi = (intrinsic)jl_unbox_int32(fv);
+            if (fi == ccall || fi == pointerset)
+                return true;
+        }
+        else if (!jl_is_func(fv)) {
+            return true;
+        }
+        else {
+            jl_fptr_t fptr = ((jl_function_t*)fv)->fptr;
+            if (fptr != &jl_f_arrayref && fptr != &jl_f_arrayset &&
+                fptr != &jl_f_arraylen && fptr != &jl_f_arraysize &&
+                fptr != &jl_f_tuple && fptr != &jl_f_tupleref &&
+                fptr != &jl_f_tuplelen && fptr != &jl_f_get_field &&
+                fptr != &jl_f_is && fptr != &jl_f_typeof &&
+                fptr != &jl_f_isa && fptr != &jl_f_typeassert)
+                return true;
+        }
+        first = 1;
+    }
+    else if (ex->head != assign_sym && ex->head != goto_ifnot_sym &&
+             ex->head != return_sym && ex->head != new_sym &&
+             ex->head != line_sym && ex->head != newvar_sym &&
+             ex->head != boundscheck_sym && ex->head != null_sym &&
+             ex->head != static_typeof_sym) {
+        return true;
+    }
+    for(i=first; i < jl_array_len(ex->args); i++) {
+        if (may_resize_arrays(jl_exprarg(ex,i), ctx))
+            return true;
+    }
+    return false;
+}
+
+static void find_loop_ranges(jl_array_t *stmts, jl_codectx_t *ctx)
+{
+    size_t n = jl_array_len(stmts);
+    size_t i, j;
+    // statements assigning each variable, and where each label is
+    std::map<jl_sym_t*, std::vector<size_t> > assigns;
+    std::map<int, size_t> labelpos;
+    size_t firstlabel = n;
+    for(i=0; i < n; i++) {
+        jl_value_t *st = jl_cellref(stmts,i);
+        if (jl_is_labelnode(st)) {
+            labelpos[jl_labelnode_label(st)] = i;
+            if (firstlabel == n)
+                firstlabel = i;
+        }
+        else if (jl_is_expr(st) && ((jl_expr_t*)st)->head == assign_sym) {
+            jl_sym_t *s = local_var_sym(jl_exprarg(st,0), ctx);
+            if (s != NULL)
+                assigns[s].push_back(i);
+        }
+    }
+
+    for(size_t g=0; g < n; g++) {
+        jl_value_t *st = jl_cellref(stmts,g);
+        if (!jl_is_expr(st) || ((jl_expr_t*)st)->head != goto_ifnot_sym)
+            continue;
+        jl_value_t *cond = jl_exprarg(st,0);
+        if (!is_intrinsic_call(cond, sle_int, 2, ctx))
+            continue;
+        std::map<int, size_t>::iterator endit =
+            labelpos.find(jl_unbox_long(jl_exprarg(st,1)));
+        if (endit == labelpos.end() || endit->second < g)
+            continue;
+        size_t last = endit->second;
+
+        // the counter: starts at a constant and only counts up
+        jl_sym_t *cnt = local_var_sym(jl_exprarg(cond,1), ctx);
+        if (!is_gensym_var(cnt, ctx) || assigns[cnt].size() != 2)
+            continue;
+        jl_value_t *init = jl_exprarg(jl_cellref(stmts, assigns[cnt][0]), 1);
+        jl_value_t *incr = jl_exprarg(jl_cellref(stmts, assigns[cnt][1]), 1);
+        int64_t step;
+        if (!is_small_int(init) || assigns[cnt][0] > g ||
+            assigns[cnt][1] < g || assigns[cnt][1] > last ||
+            local_var_sym(split_offset(incr, &step, ctx), ctx) != cnt || step != 1)
+            continue;
+        int64_t lo = jl_unbox_long(init);
+
+        // the limit: an array size, computed once before the loop
+        jl_sym_t *lim = local_var_sym(jl_exprarg(cond,2), ctx);
+        if (!is_gensym_var(lim, ctx) || assigns[lim].size() != 1 || assigns[lim][0] > g)
+            continue;
+        int64_t offs;
+        jl_value_t *bound = split_offset(jl_exprarg(jl_cellref(stmts, assigns[lim][0]), 1),
+                                         &offs, ctx);
+        int dim;
+        if (is_builtin_call(bound, &jl_f_arraylen, 1, ctx))
+            dim = 0;
+        else if (is_builtin_call(bound, &jl_f_arraysize, 2, ctx) &&
+                 jl_is_long(jl_exprarg(bound,2)) && jl_unbox_long(jl_exprarg(bound,2)) >= 1)
+            dim = jl_unbox_long(jl_exprarg(bound,2));
+        else
+            continue;
+
+        // the array must be the same one throughout. unlike other arrays, a
+        // 1-d array can be resized by any call that it is visible to.
+        jl_sym_t *array = local_var_sym(jl_exprarg(bound,1), ctx);
+        if (array == NULL || ctx->vars[array].isCaptured)
+            continue;
+        jl_varinfo_t &avi = ctx->vars[array];
+        std::vector<size_t> &aassigns = assigns[array];
+        if (!(avi.isArgument && !avi.isAssigned && aassigns.empty()) &&
+            !(!avi.isArgument && aassigns.size() == 1 && aassigns[0] < firstlabel))
+            continue;
+        jl_value_t *aty = avi.declType;
+        if (!jl_is_array_type(aty) || !jl_is_long(jl_tparam1(aty)) ||
+            jl_unbox_long(jl_tparam1(aty)) == 1) {
+            bool resizes = false;
+            for(j=assigns[lim][0]; j < last && !resizes; j++)
+                resizes = may_resize_arrays(jl_cellref(stmts,j), ctx);
+            if (resizes)
+                continue;
+        }
+
+        // the loop variable, assigned first thing in the body
+        size_t p = g+1;
+        while (p < last && (jl_is_linenode(jl_cellref(stmts,p)) ||
+                            (jl_is_expr(jl_cellref(stmts,p)) &&
+                             (((jl_expr_t*)jl_cellref(stmts,p))->head == line_sym ||
+                              ((jl_expr_t*)jl_cellref(stmts,p))->head == newvar_sym))))
+            p++;
+        jl_value_t *pst = jl_cellref(stmts,p);
+        if (p >= last || !jl_is_expr(pst) || ((jl_expr_t*)pst)->head != assign_sym ||
+            local_var_sym(jl_exprarg(pst,1), ctx) != cnt)
+            continue;
+        jl_sym_t *var = local_var_sym(jl_exprarg(pst,0), ctx);
+        if (var == NULL || ctx->vars[var].isCaptured)
+            continue;
+        bool reassigned = false;
+        for(j=0; j < assigns[var].size(); j++) {
+            size_t k = assigns[var][j];
+            if (k != p && k > g && k < last)
+                reassigned = true;
+        }
+        if (reassigned)
+            continue;
+
+        jl_looprange_t r;
+        r.first = p;
+        r.last = last;
+        r.lo = lo;
+        r.array = array;
+        r.dim = dim;
+        r.offs = offs;
+        (*ctx->loopranges)[var].push_back(r);
+    }
+}
+
+// whether index expression idx is known to be in 1:length(a) (dim == 0)
+// or 1:size(a,dim) at the current statement
+static bool index_in_bounds(jl_value_t *a, jl_value_t *idx, int dim, jl_codectx_t *ctx)
+{
+    jl_sym_t *aname = local_var_sym(a, ctx);
+    if (aname == NULL)
+        return false;
+    int64_t c;
+    jl_sym_t *var = local_var_sym(split_offset(idx, &c, ctx), ctx);
+    if (var == NULL || ctx->loopranges->find(var) == ctx->loopranges->end())
+        return false;
+    jl_value_t *aty = ctx->vars[aname].declType;
+    bool is1d = jl_is_array_type(aty) && jl_is_long(jl_tparam1(aty)) &&
+        jl_unbox_long(jl_tparam1(aty)) == 1;
+    std::vector<jl_looprange_t> &ranges = (*ctx->loopranges)[var];
+    for(size_t i=0; i < ranges.size(); i++) {
+        jl_looprange_t &r = ranges[i];
+        if (ctx->stmt <= r.first || ctx->stmt > r.last || r.array != aname)
+            continue;
+        // size(a,1) is the length of a vector
+        if (r.dim != dim && !(is1d && r.dim <= 1 && dim <= 1))
+            continue;
+        if (r.lo + c >= 1 && r.offs + c <= 0)
+            return true;
+    }
+    return false;
+}
+
 // --- escape analysis ---
 
 static bool expr_is_symbol(jl_value_t *e)
@@ -966,6 +1381,7 @@ static void jl_add_linfo_root(jl_lambda_info_t *li, jl_value_t *val)
     if (li->roots == NULL) {
         li->roots = jl_alloc_cell_1d(1);
         jl_cellset(li->roots, 0, val);
+        jl_gc_wb(li, li->roots);
     }
     else {
         size_t rlen = jl_array_dim0(li->roots);
@@ -1140,8 +1556,9 @@ static void emit_setfield(jl_datatype_t *sty, Value *strct, size_t idx,
                               ConstantInt::get(T_size, sty->fields[idx].offset + sizeof(void*)));
         jl_value_t *jfty = jl_tupleref(sty->types, idx);
         if (sty->fields[idx].isptr) {
-            builder.CreateStore(boxed(rhs,ctx),
-                                builder.CreateBitCast(addr, jl_ppvalue_llvmt));
+            Value *r = boxed(rhs,ctx);
+            builder.CreateStore(r, builder.CreateBitCast(addr, jl_ppvalue_llvmt));
+            emit_write_barrier(ctx, strct, r);
         }
         else {
             typed_store(addr, ConstantInt::get(T_size, 0), rhs, jfty, ctx);
@@ -1259,6 +1676,10 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                 */
                 f = jl_get_specialization(f, aty);
                 if (f != NULL) {
+                    // callees of fully optimized code are hot too; call
+                    // their optimized version directly
+                    if (!quick_compile && f->linfo->quickCompiled)
+                        jl_tier_up(f->linfo);
                     assert(f->linfo->functionObject != NULL);
                     *theFptr = (Value*)f->linfo->functionObject;
                     *theF = f;
@@ -1489,9 +1910,7 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
 #else
         size_t nwords = nargs+2;
 #endif
-        Value *tup = 
-            builder.CreateCall(jlallocobj_func,
-                               ConstantInt::get(T_size, sizeof(void*)*nwords));
+        Value *tup = emit_allocobj(sizeof(void*)*nwords);
 #ifdef OVERLAP_TUPLE_LEN
         builder.CreateStore(arg1, emit_nthptr_addr(tup, 1));
 #else
@@ -1532,6 +1951,9 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
             }
             Value *argi = boxed(argval,ctx);
             builder.CreateStore(argi, emit_nthptr_addr(tup, i+offs));
+            // the tuple may have been promoted while evaluating the argument
+            if (rooted)
+                emit_write_barrier(ctx, tup, argi);
         }
         ctx->argDepth = last_depth;
         JL_GC_POP();
@@ -1660,7 +2082,7 @@ static Value *emit_known_call(jl_value_t *ff, jl_value_t **args, size_t nargs,
                     else {
                         typed_store(emit_arrayptr(ary,args[1],ctx), idx,
                                     ety==(jl_value_t*)jl_any_type ? emit_expr(args[2],ctx) : emit_unboxed(args[2],ctx),
-                                    ety, ctx);
+                                    ety, ctx, ary);
                     }
                     JL_GC_POP();
                     return ary;
@@ -1750,6 +2172,62 @@ static Value *emit_jlcall(Value *theFptr, Value *theF, jl_value_t **args,
     return result;
 }
 
+// call a known generic function through an inline cache; see
+// jl_apply_generic_ic in gf.c for the layout of the cache table
+static Value *emit_jlcall_ic(Value *theF, jl_value_t **args, size_t nargs,
+                             jl_codectx_t *ctx)
+{
+    assert(nargs > 0 && nargs <= JL_IC_MAX_ARGS);
+    // emit arguments
+    int argStart = ctx->argDepth;
+    Value *argvals[JL_IC_MAX_ARGS];
+    for(size_t i=0; i < nargs; i++) {
+        Value *anArg = emit_expr(args[i], ctx);
+        argvals[i] = boxed(anArg, ctx, expr_type(args[i],ctx));
+        make_gcroot(argvals[i], ctx);
+    }
+    Value *myargs = builder.CreateGEP(ctx->argTemp,
+                                      ConstantInt::get(T_size, argStart+ctx->argSpaceOffs));
+
+    ArrayType *ictype = ArrayType::get(jl_pvalue_llvmt, 1+JL_IC_ENTRIES*(nargs+1));
+    GlobalVariable *ic =
+        new GlobalVariable(*jl_Module, ictype,
+                           false, GlobalVariable::PrivateLinkage,
+                           ConstantAggregateZero::get(ictype), "jl_ic");
+    Value *icp = builder.CreateConstGEP2_32(ic, 0, 0);
+
+    // check the most recently used entry inline
+    Value *hit = builder.CreateICmpEQ(builder.CreatePtrToInt(builder.CreateLoad(icp), T_size),
+                                      builder.CreateLoad(jlicepoch_var));
+    for(size_t i=0; i < nargs; i++) {
+        Value *ty = builder.CreateLoad(builder.CreateConstGEP1_32(icp, 2+i));
+        hit = builder.CreateAnd(hit, builder.CreateICmpEQ(emit_typeof(argvals[i]), ty));
+    }
+    BasicBlock *hitBB = BasicBlock::Create(getGlobalContext(),"ic_hit",ctx->f);
+    BasicBlock *missBB = BasicBlock::Create(getGlobalContext(),"ic_miss");
+    BasicBlock *doneBB = BasicBlock::Create(getGlobalContext(),"ic_done");
+    builder.CreateCondBr(hit, hitBB, missBB);
+    builder.SetInsertPoint(hitBB);
+    Value *mfunc = builder.CreateLoad(builder.CreateConstGEP1_32(icp, 1));
+    Value *theFptr = builder.CreateBitCast(emit_nthptr(mfunc, 1), jl_fptr_llvmt);
+    Value *r_hit = builder.CreateCall3(theFptr, mfunc, myargs,
+                                       ConstantInt::get(T_int32,nargs));
+    hitBB = builder.GetInsertBlock();
+    builder.CreateBr(doneBB);
+    ctx->f->getBasicBlockList().push_back(missBB);
+    builder.SetInsertPoint(missBB);
+    Value *r_miss = builder.CreateCall4(jlapplygenericic_func, theF, myargs,
+                                        ConstantInt::get(T_int32,nargs), icp);
+    builder.CreateBr(doneBB);
+    ctx->f->getBasicBlockList().push_back(doneBB);
+    builder.SetInsertPoint(doneBB);
+    PHINode *result = builder.CreatePHI(jl_pvalue_llvmt, 2);
+    result->addIncoming(r_hit, hitBB);
+    result->addIncoming(r_miss, missBB);
+    ctx->argDepth = argStart;
+    return result;
+}
+
 static Value *emit_call(jl_value_t **args, size_t arglen, jl_codectx_t *ctx,
                         jl_value_t *expr)
 {
@@ -1838,6 +2316,10 @@ static Value *emit_call(jl_value_t **args, size_t arglen, jl_codectx_t *ctx,
             result = mark_julia_type(result, jl_ast_rettype(f->linfo, f->linfo->ast));
         }
     }
+    else if (specialized && theFptr == jlapplygeneric_func &&
+             nargs > 0 && nargs <= JL_IC_MAX_ARGS) {
+        result = emit_jlcall_ic(theF, &args[1], nargs, ctx);
+    }
     else {
         result = emit_jlcall(theFptr, theF, &args[1], nargs, ctx);
     }
@@ -2047,6 +2529,12 @@ static void emit_assignment(jl_value_t *l, jl_value_t *r, jl_codectx_t *ctx)
             }
             if (builder.GetInsertBlock()->getTerminator() == NULL) {
                 builder.CreateStore(rval, bp, vi.isVolatile);
+                if (isBoxed(s, ctx) && rval->getType() == jl_pvalue_llvmt) {
+                    // bp points into a Box, which may be old
+                    Value *box = builder.CreateBitCast(builder.CreateConstGEP1_32(bp, -1),
+                                                       jl_pvalue_llvmt);
+                    emit_write_barrier(ctx, box, rval);
+                }
             }
         }
         else {
@@ -2253,7 +2741,7 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
             // fenv = theF->env
             Value *fenv = emit_nthptr(theF, 2);
             // bp = &((jl_methtable_t*)fenv)->kwsorter
-            bp = emit_nthptr_addr(fenv, 7);
+            bp = emit_nthptr_addr(fenv, offsetof(jl_methtable_t,kwsorter)/sizeof(void*));
         }
         else if (theF != NULL) {
             bp = make_gcroot(theF, ctx);
@@ -2273,7 +2761,18 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
         make_gcroot(a2, ctx);
         Value *mdargs[5] = { name, bp, literal_pointer_val(bnd), a1, a2 };
         ctx->argDepth = last_depth;
-        return builder.CreateCall(jlmethod_func, ArrayRef<Value*>(&mdargs[0], 5));
+        Value *gf = builder.CreateCall(jlmethod_func, ArrayRef<Value*>(&mdargs[0], 5));
+        // jl_method_def handles stores into bindings; other locations
+        // that might be in old objects need a barrier here.
+        if (iskw) {
+            emit_write_barrier(ctx, emit_nthptr(theF, 2), gf);
+        }
+        else if (theF == NULL && bnd == NULL && isBoxed((jl_sym_t*)mn, ctx)) {
+            Value *box = builder.CreateBitCast(builder.CreateConstGEP1_32(bp, -1),
+                                               jl_pvalue_llvmt);
+            emit_write_barrier(ctx, box, gf);
+        }
+        return gf;
     }
     else if (head == const_sym) {
         jl_sym_t *sym = (jl_sym_t*)args[0];
@@ -2351,10 +2850,7 @@ static Value *emit_expr(jl_value_t *expr, jl_codectx_t *ctx, bool isboxed,
                     if (might_need_root(args[1]) || fval->getType() != jl_pvalue_llvmt)
                         make_gcroot(f1, ctx);
                 }
-                Value *strct =
-                    builder.CreateCall(jlallocobj_func,
-                                       ConstantInt::get(T_size,
-                                                        sizeof(void*)+sty->size));
+                Value *strct = emit_allocobj(sizeof(void*)+sty->size);
                 builder.CreateStore(literal_pointer_val((jl_value_t*)ty),
                                     emit_nthptr_addr(strct, (size_t)0));
                 if (f1) {
@@ -2748,10 +3244,12 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     //JL_PRINTF((jl_value_t*)ast);
     //JL_PRINTF(JL_STDOUT, "\n");
     std::map<jl_sym_t*, jl_arrayvar_t> arrayvars;
+    std::map<jl_sym_t*, std::vector<jl_looprange_t> > loopranges;
     std::map<int, BasicBlock*> labels;
     std::map<int, Value*> handlers;
     jl_codectx_t ctx;
     ctx.arrayvars = &arrayvars;
+    ctx.loopranges = &loopranges;
     ctx.labels = &labels;
     ctx.handlers = &handlers;
     ctx.module = lam->module;
@@ -2762,6 +3260,9 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     ctx.vaName = NULL;
     ctx.vaStack = false;
     ctx.boundsCheck.push_back(true);
+    ctx.stmt = 0;
+    ctx.nBoundsChecks = 0;
+    ctx.nBoundsElided = 0;
 
     // step 2. process var-info lists to see what vars are captured, need boxing
     jl_array_t *largs = jl_lam_args(ast);
@@ -2829,6 +3330,9 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
     jl_array_t *stmts = jl_lam_body(ast)->args;
     mark_volatile_vars(stmts, ctx.vars);
 
+    // find array accesses that are in bounds by construction
+    find_loop_ranges(stmts, &ctx);
+
     // fetch init exprs of SSA vars for easy reference
     for(i=0; i < jl_array_len(stmts); i++) {
         jl_value_t *st = jl_cellref(stmts,i);
@@ -2886,7 +3390,7 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
                 fsig.push_back(ty);
             }
         }
-        Type *rt = (jlrettype == (jl_value_t*)jl_nothing->type ? T_void : julia_type_to_llvm(jlrettype));
+        Type *rt = (jlrettype == jl_typeof(jl_nothing) ? T_void : julia_type_to_llvm(jlrettype));
         f = Function::Create(FunctionType::get(rt, fsig, false),
                              Function::InternalLinkage, funcName, jl_Module);
         if (lam->cFunctionObject == NULL) {
@@ -3273,10 +3777,30 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
         }
     }
 
+    // under tiered compilation, count loop iterations in the blocks that
+    // backward branches jump to
+    std::set<BasicBlock*> loopheads;
+    if (quick_compile) {
+        std::set<int> seen;
+        for(i=0; i < stmtslen; i++) {
+            jl_value_t *ex = jl_cellref(stmts,i);
+            int target = -1;
+            if (jl_is_labelnode(ex))
+                seen.insert(jl_labelnode_label(ex));
+            else if (jl_is_gotonode(ex))
+                target = jl_gotonode_label(ex);
+            else if (jl_is_expr(ex) && ((jl_expr_t*)ex)->head == goto_ifnot_sym)
+                target = jl_unbox_long(jl_exprarg(ex,1));
+            if (target >= 0 && seen.find(target) != seen.end())
+                loopheads.insert(labels[target]);
+        }
+    }
+
     // step 15. compile body statements
     bool prevlabel = false;
     for(i=0; i < stmtslen; i++) {
         jl_value_t *stmt = jl_cellref(stmts,i);
+        ctx.stmt = i;
         if (jl_is_linenode(stmt)) {
             int lno = jl_linenode_line(stmt);
             if (debug_enabled)
@@ -3330,6 +3854,18 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
         }
         else {
             (void)emit_expr(stmt, &ctx, false, false);
+            if (jl_is_labelnode(stmt) &&
+                loopheads.find(builder.GetInsertBlock()) != loopheads.end()) {
+                // saturating, since one call may run a loop for longer
+                // than the count can hold
+                Value *cnt = literal_static_pointer_val(&lam->tierCount, T_pint32);
+                Value *c = builder.CreateLoad(cnt);
+                Value *notfull = builder.CreateICmpSLT(c, ConstantInt::get(T_int32, INT32_MAX));
+                builder.CreateStore(builder.CreateSelect(notfull,
+                                                         builder.CreateAdd(c, ConstantInt::get(T_int32, 1)),
+                                                         c),
+                                    cnt);
+            }
         }
     }
     // sometimes we have dangling labels after the end
@@ -3348,6 +3884,11 @@ static Function *emit_function(jl_lambda_info_t *lam, bool cstyle)
             jl_error("Inlining Pass failed");
     }
 
+    if (report_bounds_elision && ctx.nBoundsChecks > 0) {
+        JL_PRINTF(JL_STDERR, "%s: removed %d of %d bounds checks\n",
+                  ctx.funcName.c_str(), ctx.nBoundsElided, ctx.nBoundsChecks);
+    }
+
     JL_GC_POP();
     return f;
 }
@@ -3384,7 +3925,7 @@ extern "C" void jl_fptr_to_llvm(void *fptr, jl_lambda_info_t *lam, int specsig)
             if (ty != T_void && !ty->isEmptyTy())
                 fsig.push_back(ty);
         }
-        Type *rt = (jlrettype == (jl_value_t*)jl_nothing->type ? T_void : julia_type_to_llvm(jlrettype));
+        Type *rt = (jlrettype == jl_typeof(jl_nothing) ? T_void : julia_type_to_llvm(jlrettype));
         Function *f = Function::Create(FunctionType::get(rt, fsig, false),
                                        Function::ExternalLinkage, funcName, jl_Module);
         if (lam->cFunctionObject == NULL) {
@@ -3416,6 +3957,67 @@ extern "C" DLLEXPORT jl_value_t *jl_new_box(jl_value_t *v)
     return box;
 }
 
+// the full optimization pipeline. the vectorizers are left out when the
+// CPU has no usable vector unit, or when disabled globally or per function
+// (see jl_set_vectorize).
+static void add_optimization_passes(FunctionPassManager *PM, bool vectorize)
+{
+#ifdef LLVM33
+    // describe the target to the vectorizers' cost models
+    if (vectorize && jl_TargetMachine != NULL)
+        jl_TargetMachine->addAnalysisPasses(*PM);
+#endif
+    // list of passes from vmkit
+    PM->add(createCFGSimplificationPass()); // Clean up disgusting code
+    PM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
+    
+    PM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+    PM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
+    PM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
+    PM->add(createJumpThreadingPass());        // Thread jumps.
+    PM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    PM->add(createInstructionCombiningPass()); // Combine silly seq's
+    
+    PM->add(createCFGSimplificationPass());    // Merge & remove BBs
+    PM->add(createReassociatePass());          // Reassociate expressions
+
+    PM->add(createEarlyCSEPass()); //// ****
+
+    PM->add(createLoopIdiomPass()); //// ****
+    PM->add(createLoopRotatePass());           // Rotate loops.
+    PM->add(createLICMPass());                 // Hoist loop invariants
+    PM->add(createLoopUnswitchPass());         // Unswitch loops.
+    PM->add(createInstructionCombiningPass()); 
+    PM->add(createIndVarSimplifyPass());       // Canonicalize indvars
+    //PM->add(createLoopDeletionPass());         // Delete dead loops
+#ifdef LLVM33
+    if (vectorize)
+        PM->add(createLoopVectorizePass());     // Vectorize loops
+#endif
+    PM->add(createLoopUnrollPass());           // Unroll small loops
+    //PM->add(createLoopStrengthReducePass());   // (jwb added)
+    
+    PM->add(createInstructionCombiningPass()); // Clean up after the unroller
+    PM->add(createGVNPass());                  // Remove redundancies
+    //PM->add(createMemCpyOptPass());            // Remove memcpy / form memset  
+    PM->add(createSCCPPass());                 // Constant prop with SCCP
+#ifdef LLVM33
+    if (vectorize)
+        PM->add(createSLPVectorizerPass());     // Vectorize straight-line code
+#endif
+    
+    // Run instcombine after redundancy elimination to exploit opportunities
+    // opened up by them.
+    PM->add(createSinkingPass()); ////////////// ****
+    PM->add(createInstructionSimplifierPass());///////// ****
+    PM->add(createInstructionCombiningPass());
+    PM->add(createJumpThreadingPass());         // Thread jumps
+    PM->add(createDeadStoreEliminationPass());  // Delete dead stores
+
+    PM->add(createAggressiveDCEPass());         // Delete dead instructions
+    PM->add(createCFGSimplificationPass());     // Merge & remove BBs
+}
+
 static void init_julia_llvm_env(Module *m)
 {
     // every variable or function mapped in this function must be
@@ -3471,6 +4073,14 @@ static void init_julia_llvm_env(Module *m)
                            true, GlobalVariable::ExternalLinkage,
                            NULL, "jl_pgcstack");
     jl_ExecutionEngine->addGlobalMapping(jlpgcstack_var, (void*)&jl_pgcstack);
+
+    // jl_gc_bump is an array of {cur, end} pairs; it is accessed as an
+    // array of pointers
+    jlgcbump_var =
+        new GlobalVariable(*jl_Module, T_pint8,
+                           false, GlobalVariable::ExternalLinkage,
+                           NULL, "jl_gc_bump");
+    jl_ExecutionEngine->addGlobalMapping(jlgcbump_var, (void*)&jl_gc_bump);
 #endif
 
     global_to_llvm("__stack_chk_guard", (void*)&__stack_chk_guard);
@@ -3504,6 +4114,12 @@ static void init_julia_llvm_env(Module *m)
                            NULL, "jl_uv_stderr");
     jl_ExecutionEngine->addGlobalMapping(jlstderr_var, (void*)&jl_uv_stderr);
     
+    jlicepoch_var =
+        new GlobalVariable(*jl_Module, T_size,
+                           false, GlobalVariable::ExternalLinkage,
+                           NULL, "jl_ic_epoch");
+    jl_ExecutionEngine->addGlobalMapping(jlicepoch_var, (void*)&jl_ic_epoch);
+
     jlRTLD_DEFAULT_var =
         new GlobalVariable(*jl_Module, T_pint8,
                            true, GlobalVariable::ExternalLinkage,
@@ -3608,11 +4224,30 @@ static void init_julia_llvm_env(Module *m)
     jl_ExecutionEngine->addGlobalMapping(jldeclareconst_func,
                                          (void*)&jl_declare_constant);
 
+    jlqueueroot_func =
+        Function::Create(FunctionType::get(T_void, args_1ptr, false),
+                         Function::ExternalLinkage,
+                         "jl_gc_queue_root", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlqueueroot_func,
+                                         (void*)&jl_gc_queue_root);
+
     jltuple_func = jlcall_func_to_llvm("jl_f_tuple", (void*)&jl_f_tuple);
     jlapplygeneric_func =
         jlcall_func_to_llvm("jl_apply_generic", (void*)&jl_apply_generic);
     jlgetfield_func = jlcall_func_to_llvm("jl_f_get_field", (void*)&jl_f_get_field);
 
+    std::vector<Type*> icargs(0);
+    icargs.push_back(jl_pvalue_llvmt);
+    icargs.push_back(jl_ppvalue_llvmt);
+    icargs.push_back(T_int32);
+    icargs.push_back(jl_ppvalue_llvmt);
+    jlapplygenericic_func =
+        Function::Create(FunctionType::get(jl_pvalue_llvmt, icargs, false),
+                         Function::ExternalLinkage,
+                         "jl_apply_generic_ic", jl_Module);
+    jl_ExecutionEngine->addGlobalMapping(jlapplygenericic_func,
+                                         (void*)&jl_apply_generic_ic);
+
     std::vector<Type*> args3(0);
     args3.push_back(jl_pvalue_llvmt);
     jlbox_func =
@@ -3762,53 +4397,31 @@ static void init_julia_llvm_env(Module *m)
 #endif
     FPM->add(jl_data_layout);
 
-    // list of passes from vmkit
-    FPM->add(createCFGSimplificationPass()); // Clean up disgusting code
-    FPM->add(createPromoteMemoryToRegisterPass());// Kill useless allocas
-    
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createScalarReplAggregatesPass()); // Break up aggregate allocas
-    FPM->add(createInstructionCombiningPass()); // Cleanup for scalarrepl.
-    FPM->add(createJumpThreadingPass());        // Thread jumps.
-    FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    FPM->add(createInstructionCombiningPass()); // Combine silly seq's
-    
-    FPM->add(createCFGSimplificationPass());    // Merge & remove BBs
-    FPM->add(createReassociatePass());          // Reassociate expressions
-
-#if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR == 3 && LLVM_VERSION_MINOR >= 1
-    // this has the potential to make some things a bit slower
-    //FPM->add(createBBVectorizePass());
+    add_optimization_passes(FPM, jl_vectorize_enabled);
+    FPM->doInitialization();
+    if (jl_vectorize_enabled) {
+        NoVecFPM = new FunctionPassManager(jl_Module);
+#ifdef LLVM32
+        NoVecFPM->add(new DataLayout(*jl_ExecutionEngine->getDataLayout()));
+#else
+        NoVecFPM->add(new TargetData(*jl_ExecutionEngine->getTargetData()));
 #endif
-    FPM->add(createEarlyCSEPass()); //// ****
-
-    FPM->add(createLoopIdiomPass()); //// ****
-    FPM->add(createLoopRotatePass());           // Rotate loops.
-    FPM->add(createLICMPass());                 // Hoist loop invariants
-    FPM->add(createLoopUnswitchPass());         // Unswitch loops.
-    FPM->add(createInstructionCombiningPass()); 
-    FPM->add(createIndVarSimplifyPass());       // Canonicalize indvars
-    //FPM->add(createLoopDeletionPass());         // Delete dead loops
-    FPM->add(createLoopUnrollPass());           // Unroll small loops
-    //FPM->add(createLoopStrengthReducePass());   // (jwb added)
-    
-    FPM->add(createInstructionCombiningPass()); // Clean up after the unroller
-    FPM->add(createGVNPass());                  // Remove redundancies
-    //FPM->add(createMemCpyOptPass());            // Remove memcpy / form memset  
-    FPM->add(createSCCPPass());                 // Constant prop with SCCP
-    
-    // Run instcombine after redundancy elimination to exploit opportunities
-    // opened up by them.
-    FPM->add(createSinkingPass()); ////////////// ****
-    FPM->add(createInstructionSimplifierPass());///////// ****
-    FPM->add(createInstructionCombiningPass());
-    FPM->add(createJumpThreadingPass());         // Thread jumps
-    FPM->add(createDeadStoreEliminationPass());  // Delete dead stores
-
-    FPM->add(createAggressiveDCEPass());         // Delete dead instructions
-    FPM->add(createCFGSimplificationPass());     // Merge & remove BBs
+        add_optimization_passes(NoVecFPM, false);
+        NoVecFPM->doInitialization();
+    }
+    else {
+        NoVecFPM = FPM;
+    }
 
-    FPM->doInitialization();
+    QuickFPM = new FunctionPassManager(jl_Module);
+#ifdef LLVM32
+    QuickFPM->add(new DataLayout(*jl_ExecutionEngine->getDataLayout()));
+#else
+    QuickFPM->add(new TargetData(*jl_ExecutionEngine->getTargetData()));
+#endif
+    QuickFPM->add(createPromoteMemoryToRegisterPass());
+    QuickFPM->add(createCFGSimplificationPass());
+    QuickFPM->doInitialization();
 }
 
 extern "C" void jl_init_codegen(void)
@@ -3850,6 +4463,10 @@ extern "C" void jl_init_codegen(void)
     // Temporarily disable Haswell BMI2 features due to LLVM bug.
     const char *mattr[] = {"-bmi2", "-avx2"};
     std::vector<std::string> attrvec (mattr, mattr+2);
+    // the CPU may have AVX while the OS does not save its registers
+    uint32_t cpu = jl_cpu_features();
+    if ((cpu & JL_CPU_X86) && !(cpu & JL_CPU_AVX))
+        attrvec.push_back("-avx");
     jl_ExecutionEngine = EngineBuilder(jl_Module)
         .setEngineKind(EngineKind::JIT)
 #if defined(_OS_WINDOWS_) && defined(_CPU_X86_64_)
@@ -3858,6 +4475,15 @@ extern "C" void jl_init_codegen(void)
         .setTargetOptions(options)
         .setMAttrs(attrvec)
         .create();
+#ifdef LLVM33
+    jl_TargetMachine = EngineBuilder(jl_Module)
+        .setTargetOptions(options)
+        .setMAttrs(attrvec)
+        .selectTarget();
+#endif
+    // vectorizing only pays off with SIMD registers wider than a scalar
+    if ((cpu & JL_CPU_X86) && !(cpu & JL_CPU_SSE2))
+        jl_vectorize_enabled = 0;
 #endif // LLVM VERSION
     jl_ExecutionEngine->DisableLazyCompilation();
     
@@ -3873,6 +4499,8 @@ extern "C" void jl_init_codegen(void)
             jl_ExecutionEngine->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
 #endif // LLVM_USE_INTEL_JITEVENTS
+    if (const char *bc_report = std::getenv("JULIA_BOUNDSCHECK_REPORT"))
+        report_bounds_elision = std::atoi(bc_report) != 0;
 
     BOX_F(int8,int32);  BOX_F(uint8,uint32);
     BOX_F(int16,int16); BOX_F(uint16,uint16);
@@ -3920,8 +4548,9 @@ extern "C" void jl_init_codegen(void)
     jl_ExecutionEngine->addGlobalMapping(restore_arg_area_loc_func,
                                          (void*)&restore_arg_area_loc);
 
-    typeToTypeId = jl_alloc_cell_1d(16);
+    typeToTypeId = jl_alloc_cell_1d(1);
     jl_gc_preserve((jl_value_t*)typeToTypeId);
+    jl_cellset(typeToTypeId, 0, jl_alloc_cell_1d(16));
 }
 
 /*
@@ -151,8 +151,9 @@ static void jl_deserialize_globalvals(ios_t *s)
     }
 }
 
-static void jl_serialize_gv_syms(ios_t *s, jl_sym_t *v)
+static void jl_serialize_gv_sym(jl_sym_t *v, void *ctx)
 {
+    ios_t *s = (ios_t*)ctx;
     // ensures all symbols referenced in the code have
     // references in the system image to their global variable
     // since symbols are static, they might not have had a
@@ -165,8 +166,6 @@ static void jl_serialize_gv_syms(ios_t *s, jl_sym_t *v)
             write_int32(s, gv);
         }
     }
-    if (v->left) jl_serialize_gv_syms(s, v->left);
-    if (v->right) jl_serialize_gv_syms(s, v->right);
 }
 
 static void jl_deserialize_gv_syms(ios_t *s)
@@ -262,7 +261,8 @@ static void jl_serialize_datatype(ios_t *s, jl_datatype_t *dt)
         jl_serialize_value(s, dt->types);
     }
     int has_instance = !!(dt->instance != NULL);
-    write_uint8(s, dt->abstract | (dt->mutabl<<1) | (dt->pointerfree<<2) | (has_instance<<3));
+    write_uint8(s, dt->abstract | (dt->mutabl<<1) | (dt->pointerfree<<2) | (has_instance<<3) |
+                (dt->haspadding<<4));
     if (!dt->abstract)
         write_int32(s, dt->uid);
 
@@ -322,8 +322,10 @@ static int is_ast_node(jl_value_t *v)
 {
     if (jl_is_lambda_info(v)) {
         jl_lambda_info_t *li = (jl_lambda_info_t*)v;
-        if (jl_is_expr(li->ast))
+        if (jl_is_expr(li->ast)) {
             li->ast = jl_compress_ast(li, li->ast);
+            jl_gc_wb(li, li->ast);
+        }
         return 0;
     }
     return jl_is_symbol(v) || jl_is_expr(v) || jl_is_newvarnode(v) ||
@@ -536,7 +538,7 @@ static void jl_serialize_value_(ios_t *s, jl_value_t *v)
                 if ((jl_value_t*)t == jl_idtable_type) {
                     jl_array_t *data = (jl_array_t*)jl_get_nth_field(v, 0);
                     jl_value_t **d = (jl_value_t**)data->data;
-                    for(size_t i=0; i < jl_array_len(data); i+=2) {
+                    for(size_t i=0; i+1 < jl_array_len(data); i+=2) {
                         if (d[i+1] != NULL) {
                             jl_serialize_value(s, d[i+1]);
                             jl_serialize_value(s, d[i]);
@@ -607,6 +609,7 @@ static jl_value_t *jl_deserialize_datatype(ios_t *s, int pos)
     dt->mutabl = (flags>>1)&1;
     dt->pointerfree = (flags>>2)&1;
     int has_instance = (flags>>3)&1;
+    dt->haspadding = (flags>>4)&1;
     if (!dt->abstract)
         dt->uid = read_int32(s);
     else
@@ -794,6 +797,11 @@ static jl_value_t *jl_deserialize_value_internal(ios_t *s)
         li->cFunctionObject = NULL;
         li->inInference = 0;
         li->inCompile = 0;
+        li->quickCompiled = 0;
+        li->tierQueued = 0;
+        li->noVectorize = 0;
+        li->quickFptr = NULL;
+        li->tierCount = 0;
         li->unspecialized = NULL;
         li->functionID = 0;
         li->cFunctionID = 0;
@@ -948,6 +956,7 @@ void jl_save_system_image(char *fname)
         ((jl_lambda_info_t*)jl_cellref(spec,0))->inferred == 0) {
         mt->cache = JL_NULL;
         mt->cache_arg1 = JL_NULL;
+        mt->cache_leaf = JL_NULL;
         mt->defs->func->linfo->tfunc = (jl_value_t*)jl_null;
         mt->defs->func->linfo->specializations = NULL;
     }
@@ -968,7 +977,7 @@ void jl_save_system_image(char *fname)
         i += 1;
     }
     jl_serialize_globalvals(&f);
-    jl_serialize_gv_syms(&f, jl_get_root_symbol()); // serialize symbols with GlobalValue references
+    jl_foreach_symbol(jl_serialize_gv_sym, &f); // serialize symbols with GlobalValue references
     jl_serialize_value(&f, NULL); // signal the end of the symbols list
 
     write_int32(&f, jl_get_t_uid_ctr());
@@ -1095,10 +1104,13 @@ jl_value_t *jl_compress_ast(jl_lambda_info_t *li, jl_value_t *ast)
     int en = jl_gc_is_enabled();
     jl_gc_disable();
 
-    if (li->module->constant_table == NULL)
+    if (li->module->constant_table == NULL) {
         li->module->constant_table = jl_alloc_cell_1d(0);
+        jl_gc_wb(li->module, li->module->constant_table);
+    }
     tree_literal_values = li->module->constant_table;
     li->capt = (jl_value_t*)jl_lam_capt((jl_expr_t*)ast);
+    jl_gc_wb(li, li->capt);
     if (jl_array_len(li->capt) == 0)
         li->capt = NULL;
     jl_serialize_value(&dest, jl_lam_body((jl_expr_t*)ast)->etype);
@@ -1,12 +1,26 @@
 /*
   allocation and garbage collection
   . non-moving, precise mark and sweep collector
-  . pool-allocates small objects, keeps big objects on a simple list
+  . pool-allocates small objects in pages carved out of mmap'd regions,
+    keeps big objects on a simple list. pool objects are marked in per-page
+    bitmaps, so collections do not write to live objects
+  . the mark phase can be run by several threads (jl_gc_set_mark_threads)
+  . pool pages can be swept lazily, as the allocator needs them
+    (jl_gc_set_lazy_sweep)
+  . optionally generational (jl_gc_set_generational): objects that survive
+    two collections are promoted to the old generation in place, and most
+    collections are "quick" ones that only trace and sweep young objects.
+    old objects that are given references to young ones must be recorded
+    with a write barrier (jl_gc_wb and friends in julia.h).
 */
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include <assert.h>
 #include "julia.h"
+#ifndef _OS_WINDOWS_
+#include <sys/mman.h>
+#endif
 
 // with MEMDEBUG, every object is allocated explicitly with malloc, and
 // filled with 0xbb before being freed.
@@ -24,33 +38,46 @@
 // OBJPROFILE counts objects by type
 //#define OBJPROFILE
 
-#ifdef _P64
-#define GC_PAGE_SZ (1536*sizeof(void*))//bytes
-#else
-#define GC_PAGE_SZ (2048*sizeof(void*))//bytes
-#endif
-
-typedef struct _gcpage_t {
-    char data[GC_PAGE_SZ];
-    union {
-        struct _gcpage_t *next;
-        char _pad[8];
-    };
-} gcpage_t;
+#define GC_PAGE_LG2 14
+#define GC_PAGE_SZ (1 << GC_PAGE_LG2)//bytes
 
 typedef struct _gcval_t {
     union {
         struct _gcval_t *next;
         uptrint_t flags;
         uptrint_t data0;  // overlapped
-        uptrint_t marked:1;
+        uptrint_t gc_bits:2;
     };
 } gcval_t;
 
+// one bit per cell of the smallest size class
+#define GC_PAGE_AGE_SZ (GC_PAGE_SZ/8/8)
+// one bit per 8 bytes
+#define GC_PAGE_MARK_SZ (GC_PAGE_SZ/8/8)
+
+// page metadata. the cells themselves are elsewhere; see page_data.
+typedef struct _gcpage_t {
+    struct _gcpage_t *next;
+    gcval_t *freelist;   // free cells not yet handed to the allocator
+    uint32_t nfree;      // length of freelist
+    uint16_t osize;      // cell size of the pool the page belongs to
+    uint16_t nlive;      // live cells found by the last sweep
+    uint32_t has_young;  // page may contain young objects
+    double freed_time;   // when the page was last freed, if it is cached
+    uint8_t age[GC_PAGE_AGE_SZ]; // young cells that survived a collection
+    uint8_t marks[GC_PAGE_MARK_SZ]; // mark bitmap, see gc_marked
+} gcpage_t;
+
 typedef struct _pool_t {
+    jl_gc_bump_t *bump;  // run of fresh cells being allocated from, if any
     size_t osize;
     gcpage_t *pages;
-    gcval_t *freelist;
+    gcpage_t *nextpg;    // where to look for the next page with free cells
+    gcpage_t *curpg;     // page currently being allocated from
+    gcval_t *freelist;   // cells of curpg not handed out yet, when not bumping
+    uint32_t nfree;      // length of freelist
+    gcpage_t **sweep_ppg; // link to the first page not swept yet, when
+                          // sweeping lazily
 } pool_t;
 
 #ifdef _P64
@@ -60,14 +87,15 @@ typedef struct _pool_t {
 #endif
 typedef struct _bigval_t {
     struct _bigval_t *next;
-    size_t sz;
+    size_t sz:(8*sizeof(size_t)-1);
+    size_t age:1;
 #ifndef _P64
     uptrint_t _pad0;
     uptrint_t _pad1;
 #endif
     union {
         uptrint_t flags;
-        uptrint_t marked:1;
+        uptrint_t gc_bits:2;
         char _data[1];
     };
 } bigval_t;
@@ -85,21 +113,324 @@ static size_t max_collect_interval = 500000000UL;
 #endif
 int jl_in_gc; // referenced from switchto task.c
 
+// allocation profiling; see alloc_prof_sample. the allocators subtract
+// each allocation from a byte countdown, which is kept out of reach while
+// the profiler is off.
+static int64_t alloc_prof_left = INT64_MAX;
+static void alloc_prof_sample(void *v, size_t sz, int typed);
+#define alloc_prof_note(v, sz, typed)                                   \
+    do { if ((alloc_prof_left -= (int64_t)(sz)) < 0)                    \
+            alloc_prof_sample(v, sz, typed); } while (0)
+
+// collection policy. all three are off (0) by default, which leaves the
+// interval to the yield heuristic alone.
+// heap_limit: soft cap on live data plus the collect interval, in bytes
+// pause_target: desired longest collection, in seconds
+// gc_throughput: 0..1, how far the interval may grow past what the pause
+//   target allows when the yield heuristic asks for more
+static size_t heap_limit = 0;
+static double pause_target = 0;
+static double gc_throughput = 0;
+// measured by each collection, as moving averages
+static double mark_rate = 0;   // bytes marked per second
+static double sweep_rate = 0;  // bytes swept per second
+static double survival = 0.1;  // bytes a quick collection marks per byte allocated
+
+// generational mode
+static int generational = 0;
+// sweep pool pages when they are needed for allocation, instead of during
+// the collection. not used in generational mode, where write barriers
+// need the gc bits to be current.
+static int lazy_sweep = 0;
+// set during a collection that only traces and sweeps young objects
+static int quick_collection = 0;
+// during a quick collection, old objects count as marked
+static uptrint_t mark_mask = GC_MARKED;
+static size_t promoted_bytes = 0;
+static size_t live_bytes = 0;
+static size_t promoted_since_full = 0;
+static size_t live_bytes_after_full = 0;
+// per-generation counters
+static size_t n_quick_collections = 0;
+static size_t n_full_collections = 0;
+static int64_t total_promoted_bytes = 0;
+static size_t max_remset_len = 0;
+
 #ifdef OBJPROFILE
 static htable_t obj_counts;
 #endif
 
+static void gc_collect(int full);
+
 #ifdef GC_FINAL_STATS
 static double total_gc_time=0;
+static double quick_gc_time=0;
 static size_t total_freed_bytes=0;
 #endif
 
-// manipulating mark bits
-#define gc_marked(o)  (((gcval_t*)(o))->marked)
-#define gc_setmark(o) (((gcval_t*)(o))->marked=1)
+// page allocation. pool pages are carved out of big regions obtained with
+// mmap, aligned to their size, so that the metadata of the page holding any
+// pool cell can be found by masking its address. the metadata lives in a
+// table at the start of the region rather than next to each page.
+// pages freed by a sweep are cached, and only given back to the OS
+// (madvise) once they have been unused for page_idle_time seconds.
+
+#define REGION_SZ       ((size_t)1 << 23)  // 8MB
+#define REGION_META_PGS 24  // pages at the start of a region holding its metadata
+#define REGION_PG_COUNT (REGION_SZ/GC_PAGE_SZ - REGION_META_PGS)
+
+typedef struct _region_t {
+    gcpage_t meta[REGION_PG_COUNT];
+    uint32_t allocmap[(REGION_PG_COUNT+31)/32];  // pages in use, or cached
+    uint32_t lb;  // first word of allocmap that might have a free page
+} region_t;
+
+// make sure the metadata fits
+typedef char region_meta_fits[sizeof(region_t) <= REGION_META_PGS*GC_PAGE_SZ ? 1 : -1];
+
+#define GC_MIN_CACHED_PAGES 64
+
+static region_t **regions = NULL;
+static size_t n_regions = 0;
+static gcpage_t *free_pages = NULL;  // cached pages, newest first
+static size_t n_free_pages = 0;
+static size_t n_pages_inuse = 0;
+static double page_idle_time = 5.0;
+
+// one bit per region-sized piece of the address space, set for regions
+// holding pool pages
+#ifdef _P64
+#define REGION_MAP_BITS (48-23)
+#else
+#define REGION_MAP_BITS (32-23)
+#endif
+static uint8_t *region_map = NULL;
+
+static inline int in_pool(void *p)
+{
+    uptrint_t i = (uptrint_t)p >> 23;
+    if (region_map == NULL || i >= ((uptrint_t)1 << REGION_MAP_BITS))
+        return 0;
+    return (region_map[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline region_t *page_region(void *p)
+{
+    return (region_t*)((uptrint_t)p & ~(uptrint_t)(REGION_SZ-1));
+}
+
+static inline char *page_data(gcpage_t *pg)
+{
+    region_t *r = page_region(pg);
+    return (char*)r + (REGION_META_PGS + (pg - &r->meta[0]))*GC_PAGE_SZ;
+}
+
+// metadata of the page holding pool cell p
+static inline gcpage_t *page_meta(void *p)
+{
+    region_t *r = page_region(p);
+    return &r->meta[((char*)p - (char*)r)/GC_PAGE_SZ - REGION_META_PGS];
+}
+
+static region_t *new_region(void)
+{
+    char *mem, *r;
+#ifdef _OS_WINDOWS_
+    mem = (char*)VirtualAlloc(NULL, 2*REGION_SZ, MEM_RESERVE, PAGE_READWRITE);
+    if (mem == NULL)
+        return NULL;
+    r = (char*)(((uptrint_t)mem + REGION_SZ-1) & ~(uptrint_t)(REGION_SZ-1));
+    if (VirtualAlloc(r, REGION_META_PGS*GC_PAGE_SZ, MEM_COMMIT, PAGE_READWRITE) == NULL)
+        goto fail;
+#else
+    mem = (char*)mmap(NULL, 2*REGION_SZ, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANON, -1, 0);
+    if (mem == MAP_FAILED)
+        return NULL;
+    r = (char*)(((uptrint_t)mem + REGION_SZ-1) & ~(uptrint_t)(REGION_SZ-1));
+    if (r > mem)
+        munmap(mem, r-mem);
+    if (mem+2*REGION_SZ > r+REGION_SZ)
+        munmap(r+REGION_SZ, (mem+2*REGION_SZ)-(r+REGION_SZ));
+#endif
+    region_t *region = (region_t*)r;
+    // fresh memory is zeroed, so only the bits past the last page need setting
+    size_t last = REGION_PG_COUNT/32;
+    if (REGION_PG_COUNT%32 != 0)
+        region->allocmap[last] = ~(uint32_t)0 << (REGION_PG_COUNT%32);
+    if (region_map == NULL) {
+        // mostly untouched, so this costs little memory
+        region_map = (uint8_t*)calloc(((size_t)1 << REGION_MAP_BITS)/8, 1);
+        if (region_map == NULL)
+            goto fail;
+    }
+    region_t **newregions = (region_t**)realloc(regions, (n_regions+1)*sizeof(region_t*));
+    if (newregions == NULL)
+        goto fail;
+    regions = newregions;
+    regions[n_regions++] = region;
+    uptrint_t i = (uptrint_t)r >> 23;
+    region_map[i >> 3] |= 1 << (i & 7);
+    return region;
+
+ fail:
+#ifdef _OS_WINDOWS_
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(r, REGION_SZ);
+#endif
+    return NULL;
+}
+
+static gcpage_t *alloc_page(void)
+{
+    gcpage_t *pg = free_pages;
+    if (pg != NULL) {
+        free_pages = pg->next;
+        n_free_pages--;
+        n_pages_inuse++;
+        return pg;
+    }
+    size_t i;
+    region_t *r = NULL;
+    uint32_t j;
+    for(i=0; i < n_regions; i++) {
+        r = regions[i];
+        for(j=r->lb; j < (REGION_PG_COUNT+31)/32; j++) {
+            if (r->allocmap[j] != ~(uint32_t)0)
+                goto found;
+        }
+        r->lb = j;
+    }
+    r = new_region();
+    if (r == NULL)
+        jl_throw(jl_memory_exception);
+    j = 0;
+ found:
+    r->lb = j;
+    uint32_t bit = 0;
+    while (r->allocmap[j] & ((uint32_t)1 << bit))
+        bit++;
+    r->allocmap[j] |= (uint32_t)1 << bit;
+    pg = &r->meta[j*32 + bit];
+#ifdef _OS_WINDOWS_
+    if (VirtualAlloc(page_data(pg), GC_PAGE_SZ, MEM_COMMIT, PAGE_READWRITE) == NULL) {
+        r->allocmap[j] &= ~((uint32_t)1 << bit);
+        jl_throw(jl_memory_exception);
+    }
+#endif
+    n_pages_inuse++;
+    return pg;
+}
+
+static void free_page(gcpage_t *pg)
+{
+#ifdef MEMDEBUG
+    memset(page_data(pg), 0xbb, GC_PAGE_SZ);
+#endif
+    pg->freed_time = clock_now();
+    pg->next = free_pages;
+    free_pages = pg;
+    n_free_pages++;
+    n_pages_inuse--;
+}
+
+// give the memory of long unused cached pages back to the OS
+static void release_idle_pages(void)
+{
+    if (n_free_pages <= GC_MIN_CACHED_PAGES)
+        return;
+    double now = clock_now();
+    gcpage_t **ppg = &free_pages;
+    size_t nkept = 0;
+    while (*ppg != NULL) {
+        gcpage_t *pg = *ppg;
+        if (nkept >= GC_MIN_CACHED_PAGES && now - pg->freed_time >= page_idle_time) {
+            *ppg = pg->next;
+            n_free_pages--;
+            region_t *r = page_region(pg);
+            size_t idx = pg - &r->meta[0];
+#ifdef _OS_WINDOWS_
+            VirtualFree(page_data(pg), GC_PAGE_SZ, MEM_DECOMMIT);
+#else
+            madvise(page_data(pg), GC_PAGE_SZ, MADV_DONTNEED);
+#endif
+            r->allocmap[idx/32] &= ~((uint32_t)1 << (idx%32));
+            if (idx/32 < r->lb)
+                r->lb = idx/32;
+        }
+        else {
+            ppg = &pg->next;
+            nkept++;
+        }
+    }
+}
+
+// how long a cached page is kept before its memory is released
+DLLEXPORT void jl_gc_set_page_idle_time(double sec) { page_idle_time = sec; }
+
+// manipulating mark bits. objects in pool pages are marked in the mark
+// bitmap of their page, so that marking and sweeping do not write to live
+// objects. the gc bits in the object header then only record whether it
+// is old (or remembered, see below). other objects (big ones, and those
+// allocated outside of the GC, such as symbols) are marked in the header.
+
+// threads taking part in marking; marks are set atomically when this is
+// more than one
+static int n_marking = 1;
+
+#if defined(_COMPILER_MICROSOFT_)
+#include <intrin.h>
+#ifdef _P64
+#define gc_atomic_or(p,v) ((uptrint_t)_InterlockedOr64((volatile __int64*)(p),(__int64)(v)))
+#else
+#define gc_atomic_or(p,v) ((uptrint_t)_InterlockedOr((volatile long*)(p),(long)(v)))
+#endif
+#define gc_atomic_or8(p,v) ((uint8_t)_InterlockedOr8((volatile char*)(p),(char)(v)))
+#define gc_atomic_add(p,v) _InterlockedExchangeAdd((volatile long*)(p),(long)(v))
+#else
+#define gc_atomic_or(p,v)  __sync_fetch_and_or((p),(v))
+#define gc_atomic_or8(p,v) __sync_fetch_and_or((p),(v))
+#define gc_atomic_add(p,v) __sync_fetch_and_add((p),(v))
+#endif
+
+#define gc_bits(o)    (((gcval_t*)(o))->gc_bits)
 #define gc_val_buf(o) ((gcval_t*)(((void**)(o))-1))
 #define gc_setmark_buf(o) gc_setmark(gc_val_buf(o))
-#define gc_typeof(v) ((jl_value_t*)(((uptrint_t)jl_typeof(v))&~1UL))
+#define gc_typeof(v) jl_typeof(v)
+
+// the bit for o in its page's mark bitmap, for each 8-byte granule
+#define gc_markbyte(pg,o) (&(pg)->marks[((uptrint_t)(o) & (GC_PAGE_SZ-1)) >> 6])
+#define gc_markmask(o)    ((uint8_t)1 << ((((uptrint_t)(o)) >> 3) & 7))
+
+static inline int gc_marked(void *o)
+{
+    if (in_pool(o) && (*gc_markbyte(page_meta(o), o) & gc_markmask(o)))
+        return 1;
+    return gc_bits(o) & mark_mask;
+}
+
+// set the mark bit of o, returning whether it was not set before
+static inline int gc_setmark(void *o)
+{
+    if (gc_marked(o))
+        return 0;
+    if (in_pool(o)) {
+        uint8_t *b = gc_markbyte(page_meta(o), o);
+        uint8_t m = gc_markmask(o);
+        if (n_marking > 1)
+            return !(gc_atomic_or8(b, m) & m);
+        *b |= m;
+    }
+    else if (n_marking > 1) {
+        uptrint_t old = gc_atomic_or(&((gcval_t*)o)->flags, (uptrint_t)GC_MARKED);
+        return !(old & mark_mask);
+    }
+    else {
+        gc_bits(o) |= GC_MARKED;
+    }
+    return 1;
+}
 
 // malloc wrappers, aligned allocation
 
@@ -130,7 +461,7 @@ static inline void *malloc_a16(size_t sz)
 DLLEXPORT void *jl_gc_counted_malloc(size_t sz)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     allocd_bytes += sz;
     void *b = malloc(sz);
     if (b == NULL)
@@ -147,7 +478,7 @@ DLLEXPORT void jl_gc_counted_free(void *p, size_t sz)
 DLLEXPORT void *jl_gc_counted_realloc(void *p, size_t sz)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     allocd_bytes += ((sz+1)/2);  // NOTE: wild guess at growth amount
     void *b = realloc(p, sz);
     if (b == NULL)
@@ -158,7 +489,7 @@ DLLEXPORT void *jl_gc_counted_realloc(void *p, size_t sz)
 DLLEXPORT void *jl_gc_counted_realloc_with_old_size(void *p, size_t old, size_t sz)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     if (sz > old)
         allocd_bytes += (sz-old);
     void *b = realloc(p, sz);
@@ -170,19 +501,20 @@ DLLEXPORT void *jl_gc_counted_realloc_with_old_size(void *p, size_t old, size_t
 void *jl_gc_managed_malloc(size_t sz)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     sz = (sz+15) & -16;
     void *b = malloc_a16(sz);
     if (b == NULL)
         jl_throw(jl_memory_exception);
     allocd_bytes += sz;
+    alloc_prof_note(b, sz, 0);
     return b;
 }
 
 void *jl_gc_managed_realloc(void *d, size_t sz, size_t oldsz, int isaligned)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     sz = (sz+15) & -16;
     void *b;
 #ifdef _P64
@@ -265,10 +597,18 @@ static void sweep_weak_refs(void)
     weak_refs.len -= ndel;
 }
 
-// finalization
+// finalization. a collection does not run the finalizers of the objects it
+// finds unreachable, but queues them. the queue is drained in batches of
+// finalizer_batch at safe points: after a collection, when a pool needs a
+// new page, and when the scheduler is idle. gc() drains it completely.
 
 static htable_t finalizer_table;
 static arraylist_t to_finalize;
+static size_t finalizer_batch = 1000;  // 0 means no limit
+static int in_finalizers = 0;
+static uint64_t n_finalized = 0;
+static size_t max_finalize_queue = 0;
+static int is_gc_enabled = 1;
 
 static void schedule_finalization(void *o)
 {
@@ -303,21 +643,36 @@ static void run_finalizer(jl_value_t *o, jl_value_t *ff)
     }
 }
 
-static void run_finalizers(void)
+// run up to max queued finalizers, returning how many ran. finalizers are
+// not run while the collector is disabled, since its ephemeral pools may be
+// in use, nor from inside another finalizer.
+static size_t run_finalizers(size_t max)
 {
+    if (in_finalizers || !is_gc_enabled)
+        return 0;
+    in_finalizers = 1;
+    size_t n = 0;
     void *o = NULL;
     jl_value_t *ff = NULL;
     JL_GC_PUSH2(&o, &ff);
-    while (to_finalize.len > 0) {
+    while (to_finalize.len > 0 && n < max) {
         o = arraylist_pop(&to_finalize);
         ff = (jl_value_t*)ptrhash_get(&finalizer_table, o);
-        assert(ff != HT_NOTFOUND);
+        // queued twice by jl_gc_run_all_finalizers, and already run
+        if (ff == HT_NOTFOUND)
+            continue;
         ptrhash_remove(&finalizer_table, o);
         run_finalizer(o, ff);
+        n++;
     }
     JL_GC_POP();
+    in_finalizers = 0;
+    n_finalized += n;
+    return n;
 }
 
+#define finalizer_batch_size() (finalizer_batch == 0 ? (size_t)-1 : finalizer_batch)
+
 void jl_gc_run_all_finalizers(void)
 {
     for(size_t i=0; i < finalizer_table.size; i+=2) {
@@ -326,9 +681,23 @@ void jl_gc_run_all_finalizers(void)
             schedule_finalization(finalizer_table.table[i]);
         }
     }
-    run_finalizers();
+    run_finalizers((size_t)-1);
+}
+
+// a safe point for running one batch of queued finalizers
+DLLEXPORT size_t jl_gc_run_finalizers(void)
+{
+    if (to_finalize.len == 0)
+        return 0;
+    return run_finalizers(finalizer_batch_size());
 }
 
+DLLEXPORT void jl_gc_set_finalizer_batch(size_t n) { finalizer_batch = n; }
+DLLEXPORT size_t jl_gc_finalizer_batch(void)      { return finalizer_batch; }
+DLLEXPORT size_t jl_gc_finalizer_queue_len(void)   { return to_finalize.len; }
+DLLEXPORT size_t jl_gc_finalizer_queue_max(void)   { return max_finalize_queue; }
+DLLEXPORT uint64_t jl_gc_num_finalized(void)       { return n_finalized; }
+
 void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f)
 {
     jl_value_t **bp = (jl_value_t**)ptrhash_bp(&finalizer_table, v);
@@ -340,14 +709,165 @@ void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f)
     }
 }
 
-// big value list
+// remembered sets: old objects, and bindings, that may refer to young
+// objects. an entry is flagged by setting GC_MARKED on the old object
+// outside of a collection, so the write barrier only records it once.
+// entries are kept until everything they refer to has been promoted, and
+// objects promoted by a sweep are added, since their children may have
+// survived only once.
+
+static arraylist_t remset;
+static arraylist_t rem_bindings;
+
+DLLEXPORT void jl_gc_queue_root(jl_value_t *root)
+{
+    assert(gc_bits(root) == GC_OLD);
+    gc_bits(root) = GC_OLD|GC_MARKED;
+    arraylist_push(&remset, root);
+}
+
+DLLEXPORT void jl_gc_queue_binding(void *bnd)
+{
+    gcval_t *buf = gc_val_buf(bnd);
+    assert(buf->gc_bits == GC_OLD);
+    buf->gc_bits = GC_OLD|GC_MARKED;
+    arraylist_push(&rem_bindings, bnd);
+}
+
+// record an object that the current sweep is promoting. buffers from
+// allocb have no type tag; they are reached through their owners.
+static inline void gc_remember_promoted(gcval_t *v)
+{
+    jl_value_t *vt = (jl_value_t*)(v->flags & ~(uptrint_t)GC_BITS_MASK);
+    if (vt == NULL || vt == (jl_value_t*)jl_weakref_type ||
+        (jl_is_datatype(vt) && ((jl_datatype_t*)vt)->pointerfree))
+        return;
+    arraylist_push(&remset, v);
+}
+
+// clear the flags before marking. a full collection then traces entries
+// like any other object, and a quick one traces them explicitly.
+static void unflag_remset(void)
+{
+    size_t i;
+    if (remset.len > max_remset_len)
+        max_remset_len = remset.len;
+    for(i=0; i < remset.len; i++)
+        gc_bits(remset.items[i]) = GC_OLD;
+    for(i=0; i < rem_bindings.len; i++)
+        gc_val_buf(rem_bindings.items[i])->gc_bits = GC_OLD;
+}
+
+#define gc_young(o) (!(gc_bits(o) & GC_OLD))
+
+// whether the old object v refers to an object that is not old yet
+static int gc_refs_young(jl_value_t *v)
+{
+    jl_value_t *vt = (jl_value_t*)gc_typeof(v);
+    size_t i;
+    if (vt == (jl_value_t*)jl_tuple_type) {
+        size_t l = jl_tuple_len(v);
+        jl_value_t **data = ((jl_tuple_t*)v)->data;
+        for(i=0; i < l; i++) {
+            if (data[i] != NULL && gc_young(data[i]))
+                return 1;
+        }
+    }
+    else if (((jl_datatype_t*)(vt))->name == jl_array_typename) {
+        jl_array_t *a = (jl_array_t*)v;
+        if (a->how == 3)
+            return gc_young(jl_array_data_owner(a));
+        if (a->how == 1 &&
+            gc_young(gc_val_buf((char*)a->data - a->offset*a->elsize)))
+            return 1;
+        if (a->ptrarray && a->data != NULL) {
+            size_t l = jl_array_len(a);
+            for(i=0; i < l; i++) {
+                jl_value_t *elt = ((jl_value_t**)a->data)[i];
+                if (elt != NULL && gc_young(elt))
+                    return 1;
+            }
+        }
+    }
+    else if (vt == (jl_value_t*)jl_module_type) {
+        jl_module_t *m = (jl_module_t*)v;
+        void **table = m->bindings.table;
+        for(i=1; i < m->bindings.size; i+=2) {
+            if (table[i] != HT_NOTFOUND) {
+                jl_binding_t *b = (jl_binding_t*)table[i];
+                if (gc_young(gc_val_buf(b)) ||
+                    (b->value != NULL && gc_young(b->value)) ||
+                    gc_young(b->type))
+                    return 1;
+            }
+        }
+        for(i=0; i < m->usings.len; i++) {
+            if (gc_young(m->usings.items[i]))
+                return 1;
+        }
+        if (m->constant_table && gc_young(m->constant_table))
+            return 1;
+    }
+    else if (vt == (jl_value_t*)jl_task_type) {
+        // stacks are not worth scanning twice
+        return 1;
+    }
+    else if (jl_is_datatype(vt) && !((jl_datatype_t*)vt)->pointerfree &&
+             vt != (jl_value_t*)jl_weakref_type) {
+        jl_datatype_t *dt = (jl_datatype_t*)vt;
+        int nf = (int)jl_tuple_len(dt->names);
+        for(int f=0; f < nf; f++) {
+            if (dt->fields[f].isptr) {
+                jl_value_t *fld = *(jl_value_t**)((char*)v + dt->fields[f].offset + sizeof(void*));
+                if (fld != NULL && gc_young(fld))
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// after marking: drop entries that are dead, or that only refer to old
+// objects. children that are promoted by the coming sweep are counted
+// as young, so their parents are dropped one collection later.
+static void prune_remset(void)
+{
+    size_t i, n = 0;
+    for(i=0; i < remset.len; i++) {
+        jl_value_t *v = (jl_value_t*)remset.items[i];
+        if (generational && gc_marked(v) && gc_refs_young(v))
+            remset.items[n++] = v;
+    }
+    remset.len = n;
+    n = 0;
+    for(i=0; i < rem_bindings.len; i++) {
+        jl_binding_t *b = (jl_binding_t*)rem_bindings.items[i];
+        if (generational && gc_marked(gc_val_buf(b)) &&
+            ((b->value != NULL && gc_young(b->value)) || gc_young(b->type)))
+            rem_bindings.items[n++] = b;
+    }
+    rem_bindings.len = n;
+}
+
+// after sweeping, which resets the gc bits of survivors
+static void flag_remset(void)
+{
+    size_t i;
+    for(i=0; i < remset.len; i++)
+        gc_bits(remset.items[i]) = GC_OLD|GC_MARKED;
+    for(i=0; i < rem_bindings.len; i++)
+        gc_val_buf(rem_bindings.items[i])->gc_bits = GC_OLD|GC_MARKED;
+}
+
+// big value lists
 
 static bigval_t *big_objects = NULL;
+static bigval_t *big_objects_old = NULL;
 
 static void *alloc_big(size_t sz)
 {
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
+        gc_collect(0);
     size_t offs = BVOFFS*sizeof(void*);
     if (sz+offs+15 < offs+15)  // overflow in adding offs, size was "negative"
         jl_throw(jl_memory_exception);
@@ -360,21 +880,43 @@ static void *alloc_big(size_t sz)
     //memset(v, 0xee, allocsz);
 #endif
     v->sz = sz;
+    v->age = 0;
     v->flags = 0;
     v->next = big_objects;
     big_objects = v;
     return &v->_data[0];
 }
 
-static void sweep_big(void)
+static void sweep_big_list(bigval_t **pv, int old)
 {
-    bigval_t *v = big_objects;
-    bigval_t **pv = &big_objects;
+    bigval_t *v = *pv;
     while (v != NULL) {
         bigval_t *nxt = v->next;
-        if (v->marked) {
-            pv = &v->next;
-            v->marked = 0;
+        if (v->gc_bits & GC_MARKED) {
+            int isold = 0;
+            if (generational) {
+                if (old || v->age)
+                    isold = 1;
+                else
+                    v->age = 1;
+            }
+            if (isold != old) {
+                *pv = nxt;
+                bigval_t **dest = isold ? &big_objects_old : &big_objects;
+                v->next = *dest;
+                *dest = v;
+                if (isold) {
+                    promoted_bytes += v->sz;
+                    gc_remember_promoted((gcval_t*)&v->_data[0]);
+                }
+            }
+            else {
+                pv = &v->next;
+            }
+            if (isold || !generational)
+                v->age = 0;
+            v->gc_bits = isold ? GC_OLD : 0;
+            live_bytes += v->sz;
         }
         else {
             *pv = nxt;
@@ -388,6 +930,13 @@ static void sweep_big(void)
     }
 }
 
+static void sweep_big(void)
+{
+    if (!quick_collection)
+        sweep_big_list(&big_objects_old, 1);
+    sweep_big_list(&big_objects, 0);
+}
+
 // tracking Arrays with malloc'd storage
 
 typedef struct _mallocarray_t {
@@ -396,6 +945,7 @@ typedef struct _mallocarray_t {
 } mallocarray_t;
 
 static mallocarray_t *mallocarrays = NULL;
+static mallocarray_t *mallocarrays_old = NULL;
 static mallocarray_t *mafreelist = NULL;
 
 void jl_gc_track_malloced_array(jl_array_t *a)
@@ -433,14 +983,25 @@ void jl_gc_free_array(jl_array_t *a)
     }
 }
 
-static void sweep_malloced_arrays()
+static void sweep_malloced_array_list(mallocarray_t **pma, int old)
 {
-    mallocarray_t *ma = mallocarrays;
-    mallocarray_t **pma = &mallocarrays;
+    mallocarray_t *ma = *pma;
     while (ma != NULL) {
         mallocarray_t *nxt = ma->next;
         if (gc_marked(ma->a)) {
-            pma = &ma->next;
+            live_bytes += array_nbytes(ma->a);
+            // arrays promoted by this collection move to the old list at
+            // the next one, since their age is not known until they are swept
+            int isold = generational && (gc_bits(ma->a) & GC_OLD);
+            if (isold != old) {
+                *pma = nxt;
+                mallocarray_t **dest = isold ? &mallocarrays_old : &mallocarrays;
+                ma->next = *dest;
+                *dest = ma;
+            }
+            else {
+                pma = &ma->next;
+            }
         }
         else {
             *pma = nxt;
@@ -453,6 +1014,13 @@ static void sweep_malloced_arrays()
     }
 }
 
+static void sweep_malloced_arrays(void)
+{
+    if (!quick_collection)
+        sweep_malloced_array_list(&mallocarrays_old, 1);
+    sweep_malloced_array_list(&mallocarrays, 0);
+}
+
 // pool allocation
 
 #define N_POOLS 42
@@ -460,39 +1028,104 @@ static pool_t norm_pools[N_POOLS];
 static pool_t ephe_pools[N_POOLS];
 static pool_t *pools = &norm_pools[0];
 
-static void add_page(pool_t *p)
+// new pages are allocated from by bumping a pointer. the state of the
+// normal pools is exported, for the inline allocation sequence emitted
+// by codegen (emit_allocobj).
+DLLEXPORT jl_gc_bump_t jl_gc_bump[N_POOLS];
+static jl_gc_bump_t ephe_bump[N_POOLS];
+
+static gcpage_t *add_page(pool_t *p)
 {
-    gcpage_t *pg = malloc_a16(sizeof(gcpage_t));
-    if (pg == NULL)
-        jl_throw(jl_memory_exception);
-    gcval_t *v = (gcval_t*)&pg->data[0];
-    char *lim = (char*)v + GC_PAGE_SZ - p->osize;
-    gcval_t *fl;
-    gcval_t **pfl = &fl;
-    while ((char*)v <= lim) {
-        *pfl = v;
-        pfl = &v->next;
-        v = (gcval_t*)((char*)v + p->osize);
-    }
+    gcpage_t *pg = alloc_page();
+    // the cells are handed out by bumping a pointer (see pool_next_page),
+    // so no freelist is built
+    pg->freelist = NULL;
+    pg->nfree = GC_PAGE_SZ/p->osize;
+    pg->osize = p->osize;
+    pg->nlive = 0;
+    pg->has_young = 0;
+    memset(pg->age, 0, sizeof(pg->age));
     // these statements are ordered so that interrupting after any of them
     // leaves the system in a valid state
-    *pfl = p->freelist;
     pg->next = p->pages;
     p->pages = pg;
+    if (p->sweep_ppg == &p->pages)
+        p->sweep_ppg = &pg->next;
+    return pg;
+}
+
+static gcpage_t *lazy_sweep_next(pool_t *p);
+
+// switch the pool over to the next page with free cells
+static void pool_next_page(pool_t *p)
+{
+    gcpage_t *pg = p->nextpg;
+    while (pg != NULL && pg->freelist == NULL)
+        pg = pg->next;
+    if (pg != NULL) {
+        p->nextpg = pg->next;
+    }
+    else if ((pg = lazy_sweep_next(p)) == NULL) {
+        pg = add_page(p);
+        pg->has_young = 1;
+        p->curpg = pg;
+        jl_gc_bump_t *b = p->bump;
+        char *data = page_data(pg);
+        size_t nbytes = pg->nfree*p->osize;
+        pg->nfree = 0;
+        // the whole run is counted as allocated now, so that bumping does
+        // not need to check for a collection
+        allocd_bytes += nbytes;
+        b->end = NULL;
+        b->cur = data;
+        b->end = data + nbytes;
+        return;
+    }
+    // mark the page first, so that the cells are found by the next sweep
+    // even if we are interrupted before they are handed out
+    pg->has_young = 1;
+    p->curpg = pg;
+    p->nfree = pg->nfree;
+    gcval_t *fl = pg->freelist;
+    pg->freelist = NULL;
+    pg->nfree = 0;
     p->freelist = fl;
 }
 
 static inline void *pool_alloc(pool_t *p)
 {
+    jl_gc_bump_t *b = p->bump;
+    gcval_t *v;
+    if (b->cur < b->end) {
+    bump:
+        v = (gcval_t*)b->cur;
+        b->cur += p->osize;
+        v->flags = 0;
+        return v;
+    }
     if (allocd_bytes > collect_interval)
-        jl_gc_collect();
-    allocd_bytes += p->osize;
+        gc_collect(0);
+    // finalizers may have allocated from this pool
+    if (b->cur < b->end)
+        goto bump;
     if (p->freelist == NULL) {
-        add_page(p);
+        // out of cells: a safe point to run a batch of finalizers
+        if (to_finalize.len > 0) {
+            run_finalizers(finalizer_batch_size());
+            if (b->cur < b->end)
+                goto bump;
+        }
+        if (p->freelist == NULL) {
+            pool_next_page(p);
+            if (b->cur < b->end)
+                goto bump;
+        }
     }
+    allocd_bytes += p->osize;
     assert(p->freelist != NULL);
-    gcval_t *v = p->freelist;
+    v = p->freelist;
     p->freelist = p->freelist->next;
+    p->nfree--;
     v->flags = 0;
     return v;
 }
@@ -513,63 +1146,175 @@ static int szclass(size_t sz)
     return 41;
 }
 
-static void sweep_pool(pool_t *p)
+// give the cells of the page being allocated from back to it, so that
+// the page can be swept like the others
+static void pool_release_page(pool_t *p)
 {
-    //int empty;
-    int freedall;
-    gcval_t **prev_pfl;
-    gcval_t *v;
-    gcpage_t *pg = p->pages;
-    gcpage_t **ppg = &p->pages;
-    gcval_t **pfl = &p->freelist;
-    size_t osize = p->osize;
-    size_t nfreed = 0;
-
-    size_t old_nfree = 0;
-    gcval_t *ofl = p->freelist;
-    while (ofl != NULL) {
-        old_nfree++;
-        ofl = ofl->next;
+    jl_gc_bump_t *b = p->bump;
+    if (p->curpg != NULL) {
+        uint32_t nfree = p->nfree;
+        // cells not bumped over yet may hold stale data from an earlier
+        // use of the page, including gc bits
+        char *c;
+        for(c = b->cur; c < b->end; c += p->osize) {
+            ((gcval_t*)c)->flags = 0;
+            nfree++;
+        }
+        p->curpg->nfree = nfree;
+        p->curpg = NULL;
     }
+    b->cur = b->end = NULL;
+    p->freelist = NULL;
+    p->nfree = 0;
+}
 
-    while (pg != NULL) {
-        v = (gcval_t*)&pg->data[0];
-        char *lim = (char*)v + GC_PAGE_SZ - osize;
-        //empty = 1;
-        freedall = 1;
-        prev_pfl = pfl;
-        while ((char*)v <= lim) {
-            if (!v->marked) {
-                *pfl = v;
-                pfl = &v->next;
-                nfreed++;
+// rebuild the freelist of a page. returns whether the page has no live
+// cells left, in which case the caller unlinks and frees it.
+static int sweep_page(pool_t *p, gcpage_t *pg)
+{
+    size_t osize = p->osize;
+    gcval_t *v = (gcval_t*)page_data(pg);
+    char *lim = (char*)v + GC_PAGE_SZ - osize;
+    gcval_t *fl;
+    gcval_t **pfl = &fl;
+    uint32_t nfree = 0;
+    uint32_t nlive = 0;
+    int young = 0;
+    size_t i = 0;
+    // live objects are only written to when they change generation
+    while ((char*)v <= lim) {
+        int bits = v->gc_bits;
+        uint8_t agemask = 1 << (i&7);
+        uint8_t *age = &pg->age[i>>3];
+        if (*gc_markbyte(pg, v) & gc_markmask(v)) {
+            if (!generational) {
+                if (bits != 0)
+                    v->gc_bits = 0;
+                *age &= ~agemask;
+                young = 1;
+            }
+            else if ((bits & GC_OLD) || (*age & agemask)) {
+                if (!(bits & GC_OLD)) {
+                    promoted_bytes += osize;
+                    gc_remember_promoted(v);
+                    v->gc_bits = GC_OLD;
+                }
+                *age &= ~agemask;
             }
             else {
-                v->marked = 0;
-                freedall = 0;
+                *age |= agemask;
+                young = 1;
             }
-            v = (gcval_t*)((char*)v + osize);
+            live_bytes += osize;
+            nlive++;
+        }
+        else if (quick_collection && bits == GC_OLD) {
+            // old objects are not traced by quick collections
+            nlive++;
         }
+        else {
+            *age &= ~agemask;
+            *pfl = v;
+            pfl = &v->next;
+            nfree++;
+        }
+        v = (gcval_t*)((char*)v + osize);
+        i++;
+    }
+    *pfl = NULL;
+    memset(pg->marks, 0, sizeof(pg->marks));
+    // cells that were already free before this collection are not freed
+    // by it; they are still counted in pg->nfree
+    freed_bytes += (nfree - pg->nfree)*osize;
+    if (nlive == 0)
+        return 1;
+    pg->nlive = nlive;
+    pg->freelist = fl;
+    pg->nfree = nfree;
+    pg->has_young = young;
+    return 0;
+}
+
+static void sweep_pool(pool_t *p)
+{
+    gcpage_t *pg = p->pages;
+    gcpage_t **ppg = &p->pages;
+
+    pool_release_page(p);
+    while (pg != NULL) {
         gcpage_t *nextpg = pg->next;
-        // lazy version: (empty) if the whole page was already unused, free it
-        // eager version: (freedall) free page as soon as possible
-        // the eager one uses less memory.
-        if (freedall) {
-            pfl = prev_pfl;
+        if (quick_collection && !pg->has_young) {
+            // only old objects and free cells here
+            ppg = &pg->next;
+        }
+        else if (sweep_page(p, pg)) {
+            // free pages as soon as possible; uses less memory than waiting
+            // for a page to go completely unused.
             *ppg = nextpg;
-#ifdef MEMDEBUG
-            memset(pg, 0xbb, sizeof(gcpage_t));
-#endif
-            free_a16(pg);
-            //freed_bytes += GC_PAGE_SZ;
+            free_page(pg);
         }
         else {
             ppg = &pg->next;
         }
         pg = nextpg;
     }
-    *pfl = NULL;
-    freed_bytes += (nfreed - old_nfree)*osize;
+    p->nextpg = p->pages;
+}
+
+// in lazy mode, a collection only queues the pages of each pool. they are
+// swept in order when the allocator runs out of cells, and whatever is left
+// at the start of the next collection is swept then. pool bytes freed by a
+// collection are therefore counted (in freed_bytes) during the cycle that
+// follows it.
+
+static void lazy_sweep_pool(pool_t *p)
+{
+    pool_release_page(p);
+    p->nextpg = NULL;
+    p->sweep_ppg = &p->pages;
+}
+
+// sweep queued pages of p until one has free cells
+static gcpage_t *lazy_sweep_next(pool_t *p)
+{
+    gcpage_t **ppg = p->sweep_ppg;
+    gcpage_t *pg;
+    if (ppg == NULL)
+        return NULL;
+    while ((pg = *ppg) != NULL) {
+        if (sweep_page(p, pg)) {
+            *ppg = pg->next;
+            free_page(pg);
+        }
+        else {
+            ppg = &pg->next;
+            if (pg->freelist != NULL) {
+                p->sweep_ppg = ppg;
+                return pg;
+            }
+        }
+    }
+    p->sweep_ppg = NULL;
+    return NULL;
+}
+
+static void finish_pool_sweep(pool_t *p)
+{
+    if (p->sweep_ppg == NULL)
+        return;
+    while (lazy_sweep_next(p) != NULL)
+        ;
+    p->nextpg = p->pages;
+}
+
+// marking needs every page to be swept first
+static void gc_finish_sweep(void)
+{
+    int i;
+    for(i=0; i < N_POOLS; i++) {
+        finish_pool_sweep(&norm_pools[i]);
+        finish_pool_sweep(&ephe_pools[i]);
+    }
 }
 
 // sweep phase
@@ -581,29 +1326,178 @@ static void gc_sweep(void)
     sweep_malloced_arrays();
     sweep_big();
     int i;
-    for(i=0; i < N_POOLS; i++) {
-        sweep_pool(&norm_pools[i]);
-        sweep_pool(&ephe_pools[i]);
+    if (lazy_sweep && !generational) {
+        for(i=0; i < N_POOLS; i++) {
+            lazy_sweep_pool(&norm_pools[i]);
+            lazy_sweep_pool(&ephe_pools[i]);
+        }
+    }
+    else {
+        for(i=0; i < N_POOLS; i++) {
+            sweep_pool(&norm_pools[i]);
+            sweep_pool(&ephe_pools[i]);
+        }
     }
     jl_unmark_symbols();
 }
 
 // mark phase
 
-static jl_value_t **mark_stack = NULL;
-static size_t mark_stack_size = 0;
-static size_t mark_sp = 0;
+// marking may be spread over several threads. every thread owns a queue of
+// objects still to be scanned; it pushes and pops at the top, while idle
+// threads steal half of the oldest entries from the bottom of another
+// thread's queue. an object is claimed by atomically setting its mark bit,
+// so it is scanned by exactly one thread.
+
+#ifdef OBJPROFILE
+#define GC_MAX_MARK_THREADS 1  // the object counts table is not thread-safe
+#else
+#define GC_MAX_MARK_THREADS 64
+#endif
 
-static void push_root(jl_value_t *v, int d);
+#define MAX_MARK_DEPTH 1000
+// in parallel mode objects are queued sooner, so that there is something
+// for idle threads to steal
+#define PAR_MARK_DEPTH 256
+
+typedef struct _gc_markq_t {
+    jl_value_t **items;
+    size_t bottom;     // oldest entry, where thieves take from
+    size_t top;        // next free slot, where the owner pushes and pops
+    size_t size;
+    uv_mutex_t lock;
+    int id;
+    int max_depth;
+    int epoch;         // last collection seen by a helper thread
+    double time;       // time spent marking in the current collection
+    double total_time;
+    size_t nstolen;
+} gc_markq_t;
+
+static gc_markq_t markqs[GC_MAX_MARK_THREADS];
+static int n_mark_threads = 1;
+static volatile int n_idle = 0;
+
+#ifdef _OS_WINDOWS_
+#define gc_yield() SwitchToThread()
+#else
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#define gc_yield() sched_yield()
+#endif
 
-#define gc_push_root(v,d) do {  assert(v != NULL); if (!gc_marked(v)) { push_root((jl_value_t*)(v),d); } } while (0)
+static void push_root(jl_value_t *v, int d, gc_markq_t *mq);
+
+// returns whether the caller is the one that marked o, and must scan it
+static inline int gc_try_mark(void *o)
+{
+    if (!gc_setmark(o))
+        return 0;
+#ifdef OBJPROFILE
+    void **bp = ptrhash_bp(&obj_counts, gc_typeof(o));
+    if (*bp == HT_NOTFOUND)
+        *bp = (void*)2;
+    else
+        (*((ptrint_t*)bp))++;
+#endif
+    return 1;
+}
+
+#define gc_push_root(v,d,mq) do {  assert(v != NULL); if (gc_try_mark(v)) { push_root((jl_value_t*)(v),d,mq); } } while (0)
 
 void jl_gc_setmark(jl_value_t *v)
 {
     gc_setmark(v);
 }
 
-static void gc_mark_stack(jl_gcframe_t *s, ptrint_t offset, int d)
+int jl_gc_marked(jl_value_t *v)
+{
+    return gc_marked(v);
+}
+
+static void markq_push(gc_markq_t *mq, jl_value_t *v)
+{
+    if (n_marking > 1) uv_mutex_lock(&mq->lock);
+    if (mq->top >= mq->size) {
+        if (mq->bottom > 0) {
+            memmove(mq->items, &mq->items[mq->bottom],
+                    (mq->top-mq->bottom)*sizeof(void*));
+            mq->top -= mq->bottom;
+            mq->bottom = 0;
+        }
+        if (mq->top >= mq->size) {
+            size_t newsz = mq->size>0 ? mq->size*2 : 32000;
+            mq->items = (jl_value_t**)realloc(mq->items,newsz*sizeof(void*));
+            if (mq->items == NULL) exit(1);
+            mq->size = newsz;
+        }
+    }
+    mq->items[mq->top++] = v;
+    if (n_marking > 1) uv_mutex_unlock(&mq->lock);
+}
+
+static jl_value_t *markq_pop(gc_markq_t *mq)
+{
+    jl_value_t *v = NULL;
+    if (n_marking > 1) uv_mutex_lock(&mq->lock);
+    if (mq->top > mq->bottom) {
+        v = mq->items[--mq->top];
+        if (mq->top == mq->bottom)
+            mq->top = mq->bottom = 0;
+    }
+    if (n_marking > 1) uv_mutex_unlock(&mq->lock);
+    return v;
+}
+
+// move half of the entries of some other queue to mq
+static int markq_steal(gc_markq_t *mq)
+{
+    int i;
+    for(i=1; i < n_marking; i++) {
+        gc_markq_t *victim = &markqs[(mq->id+i) % n_marking];
+        if (victim->top == victim->bottom)
+            continue;
+        uv_mutex_lock(&victim->lock);
+        size_t avail = victim->top - victim->bottom;
+        size_t n = (avail+1)/2;
+        if (avail == 0) {
+            uv_mutex_unlock(&victim->lock);
+            continue;
+        }
+        // the thief's own queue is empty, and only the thief pushes to it
+        uv_mutex_lock(&mq->lock);
+        if (mq->size < n) {
+            size_t newsz = n > 32000 ? n : 32000;
+            mq->items = (jl_value_t**)realloc(mq->items,newsz*sizeof(void*));
+            if (mq->items == NULL) exit(1);
+            mq->size = newsz;
+        }
+        memcpy(mq->items, &victim->items[victim->bottom], n*sizeof(void*));
+        mq->bottom = 0;
+        mq->top = n;
+        uv_mutex_unlock(&mq->lock);
+        victim->bottom += n;
+        if (victim->top == victim->bottom)
+            victim->top = victim->bottom = 0;
+        uv_mutex_unlock(&victim->lock);
+        mq->nstolen += n;
+        return 1;
+    }
+    return 0;
+}
+
+static int markqs_empty(void)
+{
+    int i;
+    for(i=0; i < n_marking; i++) {
+        if (markqs[i].top != markqs[i].bottom)
+            return 0;
+    }
+    return 1;
+}
+
+static void gc_mark_stack(jl_gcframe_t *s, ptrint_t offset, int d, gc_markq_t *mq)
 {
     while (s != NULL) {
         s = (jl_gcframe_t*)((char*)s + offset);
@@ -613,20 +1507,20 @@ static void gc_mark_stack(jl_gcframe_t *s, ptrint_t offset, int d)
             for(size_t i=0; i < nr; i++) {
                 jl_value_t **ptr = (jl_value_t**)((char*)rts[i] + offset);
                 if (*ptr != NULL)
-                    gc_push_root(*ptr, d);
+                    gc_push_root(*ptr, d, mq);
             }
         }
         else {
             for(size_t i=0; i < nr; i++) {
                 if (rts[i] != NULL)
-                    gc_push_root(rts[i], d);
+                    gc_push_root(rts[i], d, mq);
             }
         }
         s = s->prev;
     }
 }
 
-static void gc_mark_module(jl_module_t *m, int d)
+static void gc_mark_module(jl_module_t *m, int d, gc_markq_t *mq)
 {
     size_t i;
     void **table = m->bindings.table;
@@ -635,9 +1529,9 @@ static void gc_mark_module(jl_module_t *m, int d)
             jl_binding_t *b = (jl_binding_t*)table[i];
             gc_setmark_buf(b);
             if (b->value != NULL)
-                gc_push_root(b->value, d);
+                gc_push_root(b->value, d, mq);
             if (b->type != (jl_value_t*)jl_any_type)
-                gc_push_root(b->type, d);
+                gc_push_root(b->type, d, mq);
         }
     }
     // this is only necessary because bindings for "using" modules
@@ -645,22 +1539,22 @@ static void gc_mark_module(jl_module_t *m, int d)
     // after "using" it but before accessing it, this array might
     // contain the only reference.
     for(i=0; i < m->usings.len; i++) {
-        gc_push_root(m->usings.items[i], d);
+        gc_push_root(m->usings.items[i], d, mq);
     }
     if (m->constant_table)
-        gc_push_root(m->constant_table, d);
+        gc_push_root(m->constant_table, d, mq);
 }
 
-static void gc_mark_task(jl_task_t *ta, int d)
+static void gc_mark_task(jl_task_t *ta, int d, gc_markq_t *mq)
 {
-    if (ta->parent) gc_push_root(ta->parent, d);
-    gc_push_root(ta->last, d);
-    gc_push_root(ta->tls, d);
-    gc_push_root(ta->consumers, d);
-    gc_push_root(ta->donenotify, d);
-    gc_push_root(ta->exception, d);
-    if (ta->start)  gc_push_root(ta->start, d);
-    if (ta->result) gc_push_root(ta->result, d);
+    if (ta->parent) gc_push_root(ta->parent, d, mq);
+    gc_push_root(ta->last, d, mq);
+    gc_push_root(ta->tls, d, mq);
+    gc_push_root(ta->consumers, d, mq);
+    gc_push_root(ta->donenotify, d, mq);
+    gc_push_root(ta->exception, d, mq);
+    if (ta->start)  gc_push_root(ta->start, d, mq);
+    if (ta->result) gc_push_root(ta->result, d, mq);
     if (ta->stkbuf != NULL || ta == jl_current_task) {
         if (ta->stkbuf != NULL)
             gc_setmark_buf(ta->stkbuf);
@@ -668,14 +1562,14 @@ static void gc_mark_task(jl_task_t *ta, int d)
         ptrint_t offset;
         if (ta == jl_current_task) {
             offset = 0;
-            gc_mark_stack(jl_pgcstack, offset, d);
+            gc_mark_stack(jl_pgcstack, offset, d, mq);
         }
         else {
             offset = (char *)ta->stkbuf - ((char *)ta->stackbase - ta->ssize);
-            gc_mark_stack(ta->gcstack, offset, d);
+            gc_mark_stack(ta->gcstack, offset, d, mq);
         }
 #else
-        gc_mark_stack(ta->gcstack, 0, d);
+        gc_mark_stack(ta->gcstack, 0, d, mq);
 #endif
     }
 }
@@ -686,31 +1580,18 @@ static jl_value_t *lookforme = NULL;
 DLLEXPORT void jl_gc_lookfor(jl_value_t *v) { lookforme = v; }
 */
 
-#define MAX_MARK_DEPTH 1000
-
-static void push_root(jl_value_t *v, int d)
+// scan an object that has already been marked by the caller
+static void push_root(jl_value_t *v, int d, gc_markq_t *mq)
 {
     assert(v != NULL);
     jl_value_t *vt = (jl_value_t*)gc_typeof(v);
 
-#ifdef OBJPROFILE
-    if (!gc_marked(v)) {
-        void **bp = ptrhash_bp(&obj_counts, vt);
-        if (*bp == HT_NOTFOUND)
-            *bp = (void*)2;
-        else
-            (*((ptrint_t*)bp))++;
-    }
-#endif
-
-    gc_setmark(v);
-
     if (vt == (jl_value_t*)jl_weakref_type ||
         (jl_is_datatype(vt) && ((jl_datatype_t*)vt)->pointerfree)) {
         return;
     }
 
-    if (d >= MAX_MARK_DEPTH)
+    if (d >= mq->max_depth)
         goto queue_the_root;
 
     d++;
@@ -722,14 +1603,14 @@ static void push_root(jl_value_t *v, int d)
         for(size_t i=0; i < l; i++) {
             jl_value_t *elt = data[i];
             if (elt != NULL)
-                gc_push_root(elt, d);
+                gc_push_root(elt, d, mq);
         }
     }
     else if (((jl_datatype_t*)(vt))->name == jl_array_typename) {
         jl_array_t *a = (jl_array_t*)v;
         if (a->how == 3) {
             jl_value_t *owner = jl_array_data_owner(a);
-            gc_push_root(owner, d);
+            gc_push_root(owner, d, mq);
             return;
         }
         else if (a->how == 1) {
@@ -737,7 +1618,7 @@ static void push_root(jl_value_t *v, int d)
         }
         if (a->ptrarray && a->data!=NULL) {
             size_t l = jl_array_len(a);
-            if (l > 100000 && d > MAX_MARK_DEPTH-10) {
+            if (l > 100000 && d > mq->max_depth-10) {
                 // don't mark long arrays at high depth, to try to avoid
                 // copying the whole array into the mark queue
                 goto queue_the_root;
@@ -746,16 +1627,16 @@ static void push_root(jl_value_t *v, int d)
                 void *data = a->data;
                 for(size_t i=0; i < l; i++) {
                     jl_value_t *elt = ((jl_value_t**)data)[i];
-                    if (elt != NULL) gc_push_root(elt, d);
+                    if (elt != NULL) gc_push_root(elt, d, mq);
                 }
             }
         }
     }
     else if (vt == (jl_value_t*)jl_module_type) {
-        gc_mark_module((jl_module_t*)v, d);
+        gc_mark_module((jl_module_t*)v, d, mq);
     }
     else if (vt == (jl_value_t*)jl_task_type) {
-        gc_mark_task((jl_task_t*)v, d);
+        gc_mark_task((jl_task_t*)v, d, mq);
     }
     else {
         jl_datatype_t *dt = (jl_datatype_t*)vt;
@@ -764,107 +1645,379 @@ static void push_root(jl_value_t *v, int d)
             if (dt->fields[i].isptr) {
                 jl_value_t *fld = *(jl_value_t**)((char*)v + dt->fields[i].offset + sizeof(void*));
                 if (fld)
-                    gc_push_root(fld, d);
+                    gc_push_root(fld, d, mq);
             }
         }
     }
     return;
 
  queue_the_root:
-    if (mark_sp >= mark_stack_size) {
-        size_t newsz = mark_stack_size>0 ? mark_stack_size*2 : 32000;
-        mark_stack = (jl_value_t**)realloc(mark_stack,newsz*sizeof(void*));
-        if (mark_stack == NULL) exit(1);
-        mark_stack_size = newsz;
+    markq_push(mq, v);
+}
+
+// drain mq, then help the other threads until all queues are empty
+static void gc_mark_loop(gc_markq_t *mq)
+{
+    double t0 = clock_now();
+    jl_value_t *v;
+    for(;;) {
+        while ((v = markq_pop(mq)) != NULL)
+            push_root(v, 0, mq);
+        if (n_marking == 1)
+            break;
+        if (markq_steal(mq))
+            continue;
+        // a thread only goes idle with an empty queue, and only a busy
+        // thread adds to its queue. so once every thread is idle, all
+        // queues are empty and marking is finished.
+        gc_atomic_add(&n_idle, 1);
+        while (n_idle < n_marking && markqs_empty())
+            gc_yield();
+        if (n_idle == n_marking)
+            break;
+        gc_atomic_add(&n_idle, -1);
     }
-    mark_stack[mark_sp++] = v;
+    mq->time += clock_now()-t0;
 }
 
-static void visit_mark_stack()
+// helper threads. they are started on first use, and then sleep until
+// the next collection.
+
+static uv_mutex_t gc_threads_lock;
+static uv_cond_t gc_threads_start;
+static uv_cond_t gc_threads_done;
+static uv_thread_t gc_threads[GC_MAX_MARK_THREADS];
+static int n_gc_threads = 0;  // helper threads started so far
+static int gc_epoch = 0;
+static int n_gc_threads_running = 0;
+
+static void gc_helper_thread(void *arg)
 {
-    while (mark_sp > 0) {
-        push_root(mark_stack[--mark_sp], 0);
+    gc_markq_t *mq = (gc_markq_t*)arg;
+#ifndef _OS_WINDOWS_
+    sigset_t sset;
+    sigfillset(&sset);
+    pthread_sigmask(SIG_BLOCK, &sset, NULL);
+#endif
+    uv_mutex_lock(&gc_threads_lock);
+    for(;;) {
+        while (mq->epoch == gc_epoch)
+            uv_cond_wait(&gc_threads_start, &gc_threads_lock);
+        mq->epoch = gc_epoch;
+        if (mq->id >= n_marking)
+            continue;
+        uv_mutex_unlock(&gc_threads_lock);
+        gc_mark_loop(mq);
+        uv_mutex_lock(&gc_threads_lock);
+        if (--n_gc_threads_running == 0)
+            uv_cond_signal(&gc_threads_done);
+    }
+}
+
+// mark everything reachable from the queues, using all marking threads
+static void visit_mark_stack(void)
+{
+    if (n_marking == 1) {
+        gc_mark_loop(&markqs[0]);
+        return;
     }
+    uv_mutex_lock(&gc_threads_lock);
+    while (n_gc_threads < n_marking-1) {
+        gc_markq_t *mq = &markqs[++n_gc_threads];
+        mq->epoch = gc_epoch;
+        if (uv_thread_create(&gc_threads[n_gc_threads-1], gc_helper_thread, mq) != 0) {
+            jl_printf(JL_STDERR, "could not start GC thread\n");
+            exit(1);
+        }
+    }
+    n_idle = 0;
+    n_gc_threads_running = n_marking-1;
+    gc_epoch++;
+    uv_cond_broadcast(&gc_threads_start);
+    uv_mutex_unlock(&gc_threads_lock);
+
+    gc_mark_loop(&markqs[0]);
+
+    uv_mutex_lock(&gc_threads_lock);
+    while (n_gc_threads_running > 0)
+        uv_cond_wait(&gc_threads_done, &gc_threads_lock);
+    uv_mutex_unlock(&gc_threads_lock);
 }
 
 void jl_mark_box_caches(void);
+void jl_sweep_type_memo(void);
 
 extern jl_value_t * volatile jl_task_arg_in_transit;
-#if defined(GCTIME) || defined(GC_FINAL_STATS)
-double clock_now(void);
-#endif
 
 static void gc_mark_uv_handle(uv_handle_t *handle, void *arg)
 {
     if (handle->data) {
-        gc_push_root((jl_value_t*)(handle->data), 0);
+        gc_push_root((jl_value_t*)(handle->data), 0, (gc_markq_t*)arg);
     }
 }
 
 #include "../deps/libuv/src/queue.h"
 
-static void gc_mark_uv_state(uv_loop_t *loop)
+static void gc_mark_uv_state(uv_loop_t *loop, gc_markq_t *mq)
 {
     QUEUE *q;
-    uv_walk(loop,gc_mark_uv_handle,0);
+    uv_walk(loop,gc_mark_uv_handle,mq);
     QUEUE_FOREACH(q,&loop->active_reqs)
     {
         uv_req_t *req = QUEUE_DATA(q,uv_req_t,active_queue);
         if (req->data)
-            gc_push_root((jl_value_t*)(req->data), 0);
+            gc_push_root((jl_value_t*)(req->data), 0, mq);
     }
 }
 
+// allocation profiling. while running, one allocation is sampled each time
+// another alloc_prof_interval bytes have been allocated. its backtrace goes
+// into a buffer laid out like the one of jl_profile_get_data (instruction
+// pointers, each backtrace followed by a 0), so that base/profile.jl can
+// show it, and its type goes into a parallel list, one per backtrace.
+// an allocation spanning several intervals has its backtrace repeated, so
+// that every backtrace stands for the same number of bytes.
+
+static int alloc_prof_running = 0;
+static int64_t alloc_prof_interval = 512*1024;
+static ptrint_t *alloc_prof_data = NULL;
+static size_t alloc_prof_maxlen = 0;
+static size_t alloc_prof_len = 0;
+static jl_value_t **alloc_prof_types = NULL;
+static size_t alloc_prof_ntypes = 0;
+static size_t alloc_prof_dropped = 0;  // samples that did not fit
+// the type of the last sampled object is read only after its allocator has
+// returned and the caller has set it: at the next sample, or at the start
+// of a collection.
+static jl_value_t *alloc_prof_pending = NULL;
+static size_t alloc_prof_pending_idx = 0;
+// while profiling, the bump runs used by the pools are kept here, and the
+// ones read by generated code are empty, so that inline allocation always
+// calls into the allocators above.
+static jl_gc_bump_t alloc_prof_bump[N_POOLS];
+
+static void alloc_prof_resolve(void)
+{
+    if (alloc_prof_pending == NULL)
+        return;
+    jl_value_t *t = (jl_value_t*)gc_typeof(alloc_prof_pending);
+    if (t == NULL)
+        t = jl_nothing;
+    for(size_t i=alloc_prof_pending_idx; i < alloc_prof_ntypes; i++)
+        alloc_prof_types[i] = t;
+    alloc_prof_pending = NULL;
+}
+
+static void alloc_prof_sample(void *v, size_t sz, int typed)
+{
+    if (!alloc_prof_running) {
+        alloc_prof_left = INT64_MAX;
+        return;
+    }
+    alloc_prof_resolve();
+    size_t n = 1 + (size_t)(-alloc_prof_left)/alloc_prof_interval;
+    alloc_prof_left += n*alloc_prof_interval;
+    size_t start = alloc_prof_len;
+    if (start+1 >= alloc_prof_maxlen) {
+        alloc_prof_dropped += n;
+        return;
+    }
+    size_t len = rec_backtrace(alloc_prof_data+start, alloc_prof_maxlen-start-1);
+    alloc_prof_data[start+len] = 0;
+    len++;
+    alloc_prof_len += len;
+    size_t first = alloc_prof_ntypes;
+    alloc_prof_types[alloc_prof_ntypes++] = jl_nothing;
+    for(; n > 1 && alloc_prof_len+len <= alloc_prof_maxlen; n--) {
+        memcpy(alloc_prof_data+alloc_prof_len, alloc_prof_data+start, len*sizeof(ptrint_t));
+        alloc_prof_len += len;
+        alloc_prof_types[alloc_prof_ntypes++] = jl_nothing;
+    }
+    alloc_prof_dropped += n-1;
+    if (typed) {
+        alloc_prof_pending = (jl_value_t*)v;
+        alloc_prof_pending_idx = first;
+    }
+}
+
+DLLEXPORT int jl_alloc_profile_init(size_t maxsize, size_t sample_bytes)
+{
+    if (alloc_prof_running)
+        return -2;
+    free(alloc_prof_data);
+    free(alloc_prof_types);
+    alloc_prof_data = (ptrint_t*)malloc(maxsize*sizeof(ptrint_t));
+    // every backtrace takes at least one entry of the data buffer
+    alloc_prof_types = (jl_value_t**)malloc(maxsize*sizeof(jl_value_t*));
+    if ((alloc_prof_data == NULL || alloc_prof_types == NULL) && maxsize > 0) {
+        free(alloc_prof_data);
+        free(alloc_prof_types);
+        alloc_prof_data = NULL;
+        alloc_prof_types = NULL;
+        alloc_prof_maxlen = 0;
+        return -1;
+    }
+    alloc_prof_maxlen = maxsize;
+    alloc_prof_interval = sample_bytes > 0 ? sample_bytes : 1;
+    alloc_prof_len = 0;
+    alloc_prof_ntypes = 0;
+    alloc_prof_dropped = 0;
+    alloc_prof_pending = NULL;
+    return 0;
+}
+
+DLLEXPORT int jl_alloc_profile_start(void)
+{
+    if (alloc_prof_data == NULL)
+        return -1;
+    if (alloc_prof_running)
+        return 0;
+    for(int i=0; i < N_POOLS; i++) {
+        alloc_prof_bump[i] = jl_gc_bump[i];
+        norm_pools[i].bump = &alloc_prof_bump[i];
+        jl_gc_bump[i].end = jl_gc_bump[i].cur = NULL;
+    }
+    alloc_prof_running = 1;
+    alloc_prof_left = alloc_prof_interval;
+    return 0;
+}
+
+DLLEXPORT void jl_alloc_profile_stop(void)
+{
+    if (!alloc_prof_running)
+        return;
+    alloc_prof_resolve();
+    alloc_prof_running = 0;
+    alloc_prof_left = INT64_MAX;
+    for(int i=0; i < N_POOLS; i++) {
+        jl_gc_bump[i] = alloc_prof_bump[i];
+        norm_pools[i].bump = &jl_gc_bump[i];
+    }
+}
+
+DLLEXPORT int jl_alloc_profile_is_running(void) { return alloc_prof_running; }
+
+DLLEXPORT u_int8_t *jl_alloc_profile_get_data(void) { return (u_int8_t*)alloc_prof_data; }
+
+DLLEXPORT size_t jl_alloc_profile_len_data(void) { return alloc_prof_len; }
+
+DLLEXPORT size_t jl_alloc_profile_maxlen_data(void) { return alloc_prof_maxlen; }
+
+DLLEXPORT size_t jl_alloc_profile_dropped(void) { return alloc_prof_dropped; }
+
+DLLEXPORT void jl_alloc_profile_clear_data(void)
+{
+    alloc_prof_len = 0;
+    alloc_prof_ntypes = 0;
+    alloc_prof_dropped = 0;
+    alloc_prof_pending = NULL;
+}
+
+// the type allocated at each backtrace, or nothing for buffers that are
+// not objects (such as array data)
+DLLEXPORT jl_array_t *jl_alloc_profile_get_types(void)
+{
+    size_t n = alloc_prof_ntypes;
+    jl_array_t *a = jl_alloc_cell_1d(n);
+    alloc_prof_resolve();
+    for(size_t i=0; i < n; i++)
+        jl_cellset(a, i, alloc_prof_types[i]);
+    return a;
+}
+
 extern jl_module_t *jl_old_base_module;
+extern jl_array_t *jl_ambiguity_queue;
+extern jl_array_t *jl_dispatch_profile_tables;
+extern jl_array_t *jl_tier_queue;
+extern jl_array_t *jl_compile_log;
 
 static void gc_mark(void)
 {
+    size_t i;
+    int t;
+    gc_markq_t *mq = &markqs[0];
+
+    n_marking = n_mark_threads;
+    for(t=0; t < n_marking; t++) {
+        markqs[t].time = 0;
+        markqs[t].max_depth = n_marking > 1 ? PAR_MARK_DEPTH : MAX_MARK_DEPTH;
+    }
+    // when marking in parallel, only queue the roots here, so that all
+    // threads can start on them at once
+    if (n_marking > 1)
+        mq->max_depth = 0;
+
     // mark all roots
 
-    // active tasks
-    gc_push_root(jl_root_task, 0);
-    gc_push_root(jl_current_task, 0);
+    // active tasks. the current task's stack is modified without write
+    // barriers, so it is traced even if it is old.
+    gc_setmark(jl_current_task);
+    push_root((jl_value_t*)jl_current_task, 0, mq);
+    gc_push_root(jl_root_task, 0, mq);
 
     // modules
-    gc_push_root(jl_main_module, 0);
-    gc_push_root(jl_current_module, 0);
-    if (jl_old_base_module) gc_push_root(jl_old_base_module, 0);
+    gc_push_root(jl_main_module, 0, mq);
+    gc_push_root(jl_current_module, 0, mq);
+    if (jl_old_base_module) gc_push_root(jl_old_base_module, 0, mq);
+    if (jl_ambiguity_queue) gc_push_root(jl_ambiguity_queue, 0, mq);
+    if (jl_dispatch_profile_tables) gc_push_root(jl_dispatch_profile_tables, 0, mq);
+    if (jl_tier_queue) gc_push_root(jl_tier_queue, 0, mq);
+    if (jl_compile_log) gc_push_root(jl_compile_log, 0, mq);
 
     // invisible builtin values
-    if (jl_an_empty_cell) gc_push_root(jl_an_empty_cell, 0);
-    gc_push_root(jl_exception_in_transit, 0);
-    gc_push_root(jl_task_arg_in_transit, 0);
-    gc_push_root(jl_unprotect_stack_func, 0);
-    gc_push_root(jl_bottom_func, 0);
-    gc_push_root(jl_typetype_type, 0);
-    gc_push_root(jl_tupletype_type, 0);
+    if (jl_an_empty_cell) gc_push_root(jl_an_empty_cell, 0, mq);
+    gc_push_root(jl_exception_in_transit, 0, mq);
+    gc_push_root(jl_task_arg_in_transit, 0, mq);
+    gc_push_root(jl_unprotect_stack_func, 0, mq);
+    gc_push_root(jl_bottom_func, 0, mq);
+    gc_push_root(jl_typetype_type, 0, mq);
+    gc_push_root(jl_tupletype_type, 0, mq);
 
     // constants
-    gc_push_root(jl_null, 0);
-    gc_push_root(jl_true, 0);
-    gc_push_root(jl_false, 0);
+    gc_push_root(jl_null, 0, mq);
+    gc_push_root(jl_true, 0, mq);
+    gc_push_root(jl_false, 0, mq);
 
     // libuv loops
-    gc_mark_uv_state(jl_global_event_loop());
+    gc_mark_uv_state(jl_global_event_loop(), mq);
 
     jl_mark_box_caches();
 
-    size_t i;
+    // old objects that may refer to young ones
+    if (quick_collection) {
+        for(i=0; i < remset.len; i++) {
+            push_root((jl_value_t*)remset.items[i], 0, mq);
+        }
+        for(i=0; i < rem_bindings.len; i++) {
+            jl_binding_t *b = (jl_binding_t*)rem_bindings.items[i];
+            if (b->value != NULL)
+                gc_push_root(b->value, 0, mq);
+            gc_push_root(b->type, 0, mq);
+        }
+    }
 
     // stuff randomly preserved
     for(i=0; i < preserved_values.len; i++) {
-        gc_push_root((jl_value_t*)preserved_values.items[i], 0);
+        gc_push_root((jl_value_t*)preserved_values.items[i], 0, mq);
     }
 
     // objects currently being finalized
     for(i=0; i < to_finalize.len; i++) {
-        gc_push_root(to_finalize.items[i], 0);
+        gc_push_root(to_finalize.items[i], 0, mq);
+    }
+
+    // types recorded by the allocation profiler
+    for(i=0; i < alloc_prof_ntypes; i++) {
+        gc_push_root(alloc_prof_types[i], 0, mq);
     }
 
+    mq->max_depth = n_marking > 1 ? PAR_MARK_DEPTH : MAX_MARK_DEPTH;
     visit_mark_stack();
 
     // find unmarked objects that need to be finalized.
     // this must happen last.
+    if (n_marking > 1)
+        mq->max_depth = 0;
     for(i=0; i < finalizer_table.size; i+=2) {
         if (finalizer_table.table[i+1] != HT_NOTFOUND) {
             jl_value_t *v = finalizer_table.table[i];
@@ -877,23 +2030,58 @@ static void gc_mark(void)
                     finalizer_table.table[i+1] = HT_NOTFOUND;
                     continue;
                 }
-                gc_push_root(v, 0);
+                gc_push_root(v, 0, mq);
                 schedule_finalization(v);
             }
-            gc_push_root(finalizer_table.table[i+1], 0);
+            gc_push_root(finalizer_table.table[i+1], 0, mq);
         }
     }
 
+    mq->max_depth = n_marking > 1 ? PAR_MARK_DEPTH : MAX_MARK_DEPTH;
     visit_mark_stack();
+
+    for(t=0; t < n_marking; t++)
+        markqs[t].total_time += markqs[t].time;
 }
 
+// the number of threads used for marking. values less than 1 mean one per core.
+DLLEXPORT void jl_gc_set_mark_threads(int n)
+{
+    if (n < 1)
+        n = jl_cpu_cores();
+    if (n > GC_MAX_MARK_THREADS)
+        n = GC_MAX_MARK_THREADS;
+    n_mark_threads = n;
+}
+
+DLLEXPORT int jl_gc_mark_threads(void) { return n_mark_threads; }
+
 // collector entry point and control
 
-static int is_gc_enabled = 1;
 DLLEXPORT void jl_gc_enable(void)    { is_gc_enabled = 1; }
 DLLEXPORT void jl_gc_disable(void)   { is_gc_enabled = 0; }
 DLLEXPORT int jl_gc_is_enabled(void) { return is_gc_enabled; }
 
+// collection policy; see update_interval. 0 turns each setting off.
+// the new settings shape the interval chosen after the next collection.
+DLLEXPORT void jl_gc_set_heap_limit(size_t bytes) { heap_limit = bytes; }
+DLLEXPORT size_t jl_gc_heap_limit(void)           { return heap_limit; }
+DLLEXPORT void jl_gc_set_pause_target(double sec) { pause_target = sec > 0 ? sec : 0; }
+DLLEXPORT double jl_gc_pause_target(void)         { return pause_target; }
+DLLEXPORT void jl_gc_set_throughput(double t)
+{
+    gc_throughput = t < 0 ? 0 : (t > 1 ? 1 : t);
+}
+DLLEXPORT double jl_gc_throughput(void) { return gc_throughput; }
+
+// turning generational mode off takes effect fully at the next collection,
+// which is then a full one that demotes all survivors.
+DLLEXPORT void jl_gc_set_generational(int on) { generational = (on != 0); }
+DLLEXPORT int jl_gc_is_generational(void)     { return generational; }
+
+DLLEXPORT void jl_gc_set_lazy_sweep(int on) { lazy_sweep = (on != 0); }
+DLLEXPORT int jl_gc_is_lazy_sweep(void)     { return lazy_sweep; }
+
 DLLEXPORT int64_t jl_gc_total_bytes(void) { return total_allocd_bytes + allocd_bytes; }
 
 void jl_gc_ephemeral_on(void)  { pools = &ephe_pools[0]; }
@@ -917,7 +2105,175 @@ static void print_obj_profile(void)
 }
 #endif
 
-void jl_gc_collect(void)
+// in generational mode, collections triggered by allocation only look at
+// young objects until the old generation has grown by as much as was live
+// after the last full collection.
+// past the soft heap limit, a full collection is done as soon as the old
+// generation has grown noticeably, since quick ones cannot free old objects.
+static int want_quick_collection(void)
+{
+    size_t limit = live_bytes_after_full;
+    if (limit < default_collect_interval)
+        limit = default_collect_interval;
+    if (heap_limit > 0 && promoted_since_full >= default_collect_interval &&
+        live_bytes_after_full + promoted_since_full + collect_interval > heap_limit)
+        return 0;
+    return promoted_since_full < limit;
+}
+
+static double rate_average(double avg, double sample)
+{
+    return avg == 0 ? sample : (avg + sample)/2;
+}
+
+// record how fast this collection marked and swept, and how much of what
+// was allocated since the last one survived.
+static void gc_measure(size_t allocd, double mark_time, double sweep_time)
+{
+    // collections this short are dominated by fixed costs
+    if (mark_time > 1e-4)
+        mark_rate = rate_average(mark_rate, live_bytes/mark_time);
+    if (sweep_time > 1e-4)
+        sweep_rate = rate_average(sweep_rate, (live_bytes+freed_bytes)/sweep_time);
+    if (quick_collection && allocd > 0) {
+        double s = (double)live_bytes/allocd;
+        survival = (survival + (s > 1 ? 1 : s))/2;
+    }
+}
+
+// bytes of live data the next full collection should find
+static size_t live_estimate(void)
+{
+    if (generational)
+        return live_bytes_after_full + promoted_since_full;
+    return live_bytes;
+}
+
+// the longest interval whose collection is predicted to finish within
+// pause_target, from the measured rates. a full collection marks all live
+// data and sweeps it along with what was allocated; a quick one only marks
+// and sweeps the survivors of the young objects.
+static size_t pause_interval(void)
+{
+    if (mark_rate == 0 || sweep_rate == 0)
+        return max_collect_interval;
+    double est;
+    if (generational && want_quick_collection()) {
+        est = pause_target/(survival/mark_rate + 1/sweep_rate);
+    }
+    else {
+        double live = live_estimate();
+        est = (pause_target - live/mark_rate - live/sweep_rate)*sweep_rate;
+    }
+    if (est < default_collect_interval)
+        return default_collect_interval;
+    if (est > max_collect_interval)
+        return max_collect_interval;
+    return (size_t)est;
+}
+
+// pick the amount to allocate before the next collection. the yield
+// heuristic grows the interval while collections free little; the pause
+// target and heap limit then bound it.
+static void update_interval(size_t allocd)
+{
+    size_t interval = collect_interval;
+    if (freed_bytes < (7*(allocd/10))) {
+        if (interval <= 2*(max_collect_interval/5))
+            interval = 5*(interval/2);
+    }
+    else {
+        interval = default_collect_interval;
+    }
+    if (pause_target > 0) {
+        size_t lat = pause_interval();
+        if (interval > lat)
+            interval = lat + (size_t)(gc_throughput*(interval - lat));
+    }
+    if (heap_limit > 0) {
+        size_t live = live_estimate();
+        size_t room = heap_limit > live ? heap_limit - live : 0;
+        if (interval > room)
+            interval = room;
+    }
+    if (interval < default_collect_interval)
+        interval = default_collect_interval;
+    collect_interval = interval;
+}
+
+// collection log. a record of each of the last GC_LOG_SZ collections is
+// kept in a ring buffer, and optionally also written to a file as one JSON
+// object per line.
+
+#define GC_LOG_SZ 256
+static jl_gc_event_t gc_log[GC_LOG_SZ];
+static uint64_t n_gc_events = 0;
+static FILE *gc_log_file = NULL;
+
+static void gc_log_event(jl_gc_event_t *e)
+{
+    gc_log[n_gc_events % GC_LOG_SZ] = *e;
+    n_gc_events++;
+    if (gc_log_file != NULL) {
+        fprintf(gc_log_file,
+                "{\"n\":%llu,\"start\":%.6f,\"full\":%s,"
+                "\"mark_time\":%.6f,\"sweep_time\":%.6f,\"finalize_time\":%.6f,"
+                "\"allocd\":%lld,\"freed\":%lld,\"live\":%lld,"
+                "\"pages\":%lld,\"pages_cached\":%lld,\"nfinal\":%d}\n",
+                (unsigned long long)n_gc_events, e->start, e->full ? "true" : "false",
+                e->mark_time, e->sweep_time, e->finalize_time,
+                (long long)e->allocd, (long long)e->freed, (long long)e->live,
+                (long long)e->pages, (long long)e->pages_cached, e->nfinal);
+        fflush(gc_log_file);
+    }
+}
+
+// the finalizers run right after collection number n (counting from 1),
+// which may itself have been followed by collections they triggered. the
+// in-memory record is completed in place; the file gets a separate line.
+static void gc_log_finalizers(uint64_t n, int32_t nfinal, double dt)
+{
+    if (n_gc_events - n < GC_LOG_SZ) {
+        jl_gc_event_t *e = &gc_log[(n-1) % GC_LOG_SZ];
+        e->nfinal = nfinal;
+        e->finalize_time = dt;
+    }
+    if (gc_log_file != NULL && nfinal > 0) {
+        fprintf(gc_log_file, "{\"finalized\":%llu,\"finalize_time\":%.6f,\"nfinal\":%d}\n",
+                (unsigned long long)n, dt, nfinal);
+        fflush(gc_log_file);
+    }
+}
+
+// copy the records of up to the last n collections to out, oldest first,
+// and return how many were copied.
+DLLEXPORT size_t jl_gc_get_stats(jl_gc_event_t *out, size_t n)
+{
+    size_t avail = n_gc_events < GC_LOG_SZ ? (size_t)n_gc_events : GC_LOG_SZ;
+    if (n > avail)
+        n = avail;
+    for(size_t i=0; i < n; i++)
+        out[i] = gc_log[(n_gc_events - n + i) % GC_LOG_SZ];
+    return n;
+}
+
+DLLEXPORT uint64_t jl_gc_num_collections(void) { return n_gc_events; }
+
+// append the log to the named file, or stop writing it if path is NULL or
+// empty. returns -1 if the file cannot be opened.
+DLLEXPORT int jl_gc_set_log_file(const char *path)
+{
+    if (gc_log_file != NULL) {
+        fclose(gc_log_file);
+        gc_log_file = NULL;
+    }
+    if (path == NULL || path[0] == '\0')
+        return 0;
+    gc_log_file = fopen(path, "a");
+    return gc_log_file == NULL ? -1 : 0;
+}
+
+static void gc_collect(int full)
 {
     size_t actual_allocd = allocd_bytes;
     total_allocd_bytes += allocd_bytes;
@@ -925,59 +2281,112 @@ void jl_gc_collect(void)
     if (is_gc_enabled) {
         JL_SIGATOMIC_BEGIN();
         jl_in_gc = 1;
-#if defined(GCTIME) || defined(GC_FINAL_STATS)
-        double t0 = clock_now();
-#endif
+        alloc_prof_resolve();
+        gc_finish_sweep();
+        quick_collection = generational && !full && want_quick_collection();
+        mark_mask = quick_collection ? (GC_MARKED|GC_OLD) : GC_MARKED;
+        promoted_bytes = 0;
+        live_bytes = 0;
+        unflag_remset();
+        jl_gc_event_t ev;
+        ev.full = !quick_collection;
+        double t0 = ev.start = clock_now();
         gc_mark();
+        prune_remset();
+        double mark_time = clock_now()-t0;
 #ifdef GCTIME
-        JL_PRINTF(JL_STDERR, "mark time %.3f ms\n", (clock_now()-t0)*1000);
+        JL_PRINTF(JL_STDERR, "%s mark time %.3f ms\n",
+                  quick_collection ? "quick" : "full", mark_time*1000);
+        if (n_marking > 1) {
+            for(int t=0; t < n_marking; t++)
+                JL_PRINTF(JL_STDERR, "  mark thread %d: %.3f ms\n", t, markqs[t].time*1000);
+        }
 #endif
 #if defined(MEMPROFILE)
         all_pool_stats();
         big_obj_stats();
 #endif
-#ifdef GCTIME
-        t0 = clock_now();
-#endif
+        double t1 = clock_now();
         sweep_weak_refs();
+        jl_sweep_type_memo();
         gc_sweep();
+        flag_remset();
+        release_idle_pages();
+        double sweep_time = clock_now()-t1;
 #ifdef GCTIME
-        JL_PRINTF(JL_STDERR, "sweep time %.3f ms\n", (clock_now()-t0)*1000);
+        JL_PRINTF(JL_STDERR, "sweep time %.3f ms\n", sweep_time*1000);
 #endif
-        int nfinal = to_finalize.len;
-        run_finalizers();
+        gc_measure(actual_allocd, mark_time, sweep_time);
+        if (quick_collection) {
+            n_quick_collections++;
+            promoted_since_full += promoted_bytes;
+        }
+        else {
+            n_full_collections++;
+            promoted_since_full = 0;
+            live_bytes_after_full = live_bytes;
+        }
+        total_promoted_bytes += promoted_bytes;
+        int was_quick = quick_collection;
+        quick_collection = 0;
+        mark_mask = GC_MARKED;
+        if (to_finalize.len > max_finalize_queue)
+            max_finalize_queue = to_finalize.len;
         jl_in_gc = 0;
         JL_SIGATOMIC_END();
+        ev.mark_time = mark_time;
+        ev.sweep_time = sweep_time;
+        ev.allocd = actual_allocd;
+        ev.freed = freed_bytes;
+        ev.live = live_bytes;
+        ev.pages = n_pages_inuse;
+        ev.pages_cached = n_free_pages;
 #if defined(GC_FINAL_STATS)
-        total_gc_time += (clock_now()-t0);
+        double dt = clock_now()-t0;
+        total_gc_time += dt;
+        if (was_quick)
+            quick_gc_time += dt;
         total_freed_bytes += freed_bytes;
+#else
+        (void)was_quick;
 #endif
 #ifdef OBJPROFILE
         print_obj_profile();
         htable_reset(&obj_counts, 0);
 #endif
 
-        // tune collect interval based on current live ratio
+        // tune collect interval based on current live ratio and the policy
 #if defined(MEMPROFILE)
         jl_printf(JL_STDERR, "allocd %ld, freed %ld, interval %ld, ratio %.2f\n",
                   actual_allocd, freed_bytes, collect_interval,
                   (double)freed_bytes/(double)actual_allocd);
 #endif
-        if (freed_bytes < (7*(actual_allocd/10))) {
-            if (collect_interval <= 2*(max_collect_interval/5))
-                collect_interval = 5*(collect_interval/2);
-        }
-        else {
-            collect_interval = default_collect_interval;
-        }
+        update_interval(actual_allocd);
         freed_bytes = 0;
-        // if a lot of objects were finalized, re-run GC to finish freeing
-        // their storage if possible.
-        if (nfinal > 100000)
-            jl_gc_collect();
+
+        // log the collection before its finalizers, since they may
+        // trigger another one
+        ev.nfinal = 0;
+        ev.finalize_time = 0;
+        gc_log_event(&ev);
+        uint64_t n = n_gc_events;
+
+        // with the collector's state settled, run a first batch of the
+        // finalizers it queued. they may allocate, and even collect again.
+        double t2 = clock_now();
+        int32_t nfinal = (int32_t)run_finalizers(finalizer_batch_size());
+        gc_log_finalizers(n, nfinal, clock_now()-t2);
     }
 }
 
+// explicit requests (e.g. gc() from julia) always do a full collection,
+// and run all the finalizers it finds due
+DLLEXPORT void jl_gc_collect(void)
+{
+    gc_collect(1);
+    run_finalizers((size_t)-1);
+}
+
 // allocator entry points
 
 void *allocb(size_t sz)
@@ -994,58 +2403,100 @@ void *allocb(size_t sz)
         b = pool_alloc(&pools[szclass(sz)]);
     }
 #endif
+    alloc_prof_note(b, sz, 0);
     return (void*)((void**)b + 1);
 }
 
-DLLEXPORT void *allocobj(size_t sz)
+// the pool used by allocobj(sz), and its cell size, or -1 if objects of
+// that size are not pool-allocated. used by codegen to inline allocation.
+DLLEXPORT int jl_gc_pool_index(size_t sz, size_t *osize)
 {
 #ifdef MEMDEBUG
-    return alloc_big(sz);
+    return -1;
 #endif
     if (sz > 2048)
-        return alloc_big(sz);
-    return pool_alloc(&pools[szclass(sz)]);
+        return -1;
+    int i = szclass(sz);
+    *osize = norm_pools[i].osize;
+    return i;
 }
 
-DLLEXPORT void *alloc_2w(void)
+DLLEXPORT void *allocobj(size_t sz)
 {
+    void *v;
 #ifdef MEMDEBUG
-    return alloc_big(2*sizeof(void*));
+    v = alloc_big(sz);
+#else
+    if (sz > 2048)
+        v = alloc_big(sz);
+    else
+        v = pool_alloc(&pools[szclass(sz)]);
 #endif
-#ifdef _P64
-    return pool_alloc(&pools[2]);
+    alloc_prof_note(v, sz, 1);
+    return v;
+}
+
+DLLEXPORT void *alloc_2w(void)
+{
+    void *v;
+#ifdef MEMDEBUG
+    v = alloc_big(2*sizeof(void*));
+#elif defined(_P64)
+    v = pool_alloc(&pools[2]);
 #else
-    return pool_alloc(&pools[0]);
+    v = pool_alloc(&pools[0]);
 #endif
+    alloc_prof_note(v, 2*sizeof(void*), 1);
+    return v;
 }
 
 DLLEXPORT void *alloc_3w(void)
 {
+    void *v;
 #ifdef MEMDEBUG
-    return alloc_big(3*sizeof(void*));
-#endif
-#ifdef _P64
-    return pool_alloc(&pools[4]);
+    v = alloc_big(3*sizeof(void*));
+#elif defined(_P64)
+    v = pool_alloc(&pools[4]);
 #else
-    return pool_alloc(&pools[1]);
+    v = pool_alloc(&pools[1]);
 #endif
+    alloc_prof_note(v, 3*sizeof(void*), 1);
+    return v;
 }
 
 DLLEXPORT void *alloc_4w(void)
 {
+    void *v;
 #ifdef MEMDEBUG
-    return alloc_big(4*sizeof(void*));
-#endif
-#ifdef _P64
-    return pool_alloc(&pools[6]);
+    v = alloc_big(4*sizeof(void*));
+#elif defined(_P64)
+    v = pool_alloc(&pools[6]);
 #else
-    return pool_alloc(&pools[2]);
+    v = pool_alloc(&pools[2]);
 #endif
+    alloc_prof_note(v, 4*sizeof(void*), 1);
+    return v;
 }
 
 #ifdef GC_FINAL_STATS
 static double process_t0;
 #include <malloc.h>
+#ifdef _OS_LINUX_
+#include <unistd.h>
+static size_t current_rss(void)
+{
+    long npages = 0, nresident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%ld %ld", &npages, &nresident) != 2)
+        nresident = 0;
+    fclose(f);
+    return (size_t)nresident * sysconf(_SC_PAGESIZE);
+}
+#else
+static size_t current_rss(void) { return 0; }
+#endif
 void jl_print_gc_stats(JL_STREAM *s)
 {
     malloc_stats();
@@ -1058,6 +2509,24 @@ void jl_print_gc_stats(JL_STREAM *s)
     jl_printf(s, "total freed\t%llu b\n", total_freed_bytes);
     jl_printf(s, "free rate\t%.1f MB/sec\n",
               (total_freed_bytes/total_gc_time)/1024/1024);
+    jl_printf(s, "generational\t%s\n", generational ? "on" : "off");
+    jl_printf(s, "full gcs\t%llu\n", (unsigned long long)n_full_collections);
+    jl_printf(s, "quick gcs\t%llu (%.5f sec)\n",
+              (unsigned long long)n_quick_collections, quick_gc_time);
+    jl_printf(s, "promoted\t%llu b\n", (unsigned long long)total_promoted_bytes);
+    jl_printf(s, "max remset\t%llu\n", (unsigned long long)max_remset_len);
+    jl_printf(s, "rss      \t%llu KB\n", (unsigned long long)current_rss()/1024);
+    jl_printf(s, "pool pages\t%llu KB committed (%llu regions), %llu KB used\n",
+              (unsigned long long)((n_pages_inuse+n_free_pages)*GC_PAGE_SZ +
+                                   n_regions*REGION_META_PGS*GC_PAGE_SZ)/1024,
+              (unsigned long long)n_regions,
+              (unsigned long long)n_pages_inuse*GC_PAGE_SZ/1024);
+    jl_printf(s, "mark threads\t%d\n", n_mark_threads);
+    for(int t=0; t < GC_MAX_MARK_THREADS; t++) {
+        if (markqs[t].total_time > 0)
+            jl_printf(s, "  thread %d\t%.5f sec marking, %llu stolen\n", t,
+                      markqs[t].total_time, (unsigned long long)markqs[t].nstolen);
+    }
 }
 #endif
 
@@ -1078,18 +2547,40 @@ void jl_gc_init(void)
     int i;
     for(i=0; i < N_POOLS; i++) {
         norm_pools[i].osize = szc[i];
+        norm_pools[i].bump = &jl_gc_bump[i];
+        jl_gc_bump[i].cur = jl_gc_bump[i].end = NULL;
         norm_pools[i].pages = NULL;
+        norm_pools[i].nextpg = NULL;
+        norm_pools[i].curpg = NULL;
         norm_pools[i].freelist = NULL;
+        norm_pools[i].nfree = 0;
+        norm_pools[i].sweep_ppg = NULL;
 
         ephe_pools[i].osize = szc[i];
+        ephe_pools[i].bump = &ephe_bump[i];
+        ephe_bump[i].cur = ephe_bump[i].end = NULL;
         ephe_pools[i].pages = NULL;
+        ephe_pools[i].nextpg = NULL;
+        ephe_pools[i].curpg = NULL;
         ephe_pools[i].freelist = NULL;
+        ephe_pools[i].nfree = 0;
+        ephe_pools[i].sweep_ppg = NULL;
     }
 
     htable_new(&finalizer_table, 0);
     arraylist_new(&to_finalize, 0);
     arraylist_new(&preserved_values, 0);
     arraylist_new(&weak_refs, 0);
+    arraylist_new(&remset, 0);
+    arraylist_new(&rem_bindings, 0);
+
+    for(i=0; i < GC_MAX_MARK_THREADS; i++) {
+        markqs[i].id = i;
+        uv_mutex_init(&markqs[i].lock);
+    }
+    uv_mutex_init(&gc_threads_lock);
+    uv_cond_init(&gc_threads_start);
+    uv_cond_init(&gc_threads_done);
 
 #ifdef OBJPROFILE
     htable_new(&obj_counts, 0);
@@ -1118,10 +2609,10 @@ static size_t pool_stats(pool_t *p, size_t *pwaste)
 
     while (pg != NULL) {
         npgs++;
-        v = (gcval_t*)&pg->data[0];
+        v = (gcval_t*)page_data(pg);
         char *lim = (char*)v + GC_PAGE_SZ - osize;
         while ((char*)v <= lim) {
-            if (!v->marked) {
+            if (!gc_marked(v)) {
                 nfree++;
             }
             else {
@@ -1164,25 +2655,35 @@ static void all_pool_stats(void)
                no, nb, tw);
 }
 
-static void big_obj_stats(void)
+static void big_list_stats(bigval_t *v, size_t *pnused, size_t *pnbytes)
 {
-    bigval_t *v = big_objects;
-    size_t nused=0, nbytes=0;
     while (v != NULL) {
-        if (v->marked) {
-            nused++;
-            nbytes += v->sz;
+        if (v->gc_bits & mark_mask) {
+            (*pnused)++;
+            *pnbytes += v->sz;
         }
         v = v->next;
     }
-    mallocarray_t *ma = mallocarrays;
+}
+
+static void malloced_list_stats(mallocarray_t *ma, size_t *pnused, size_t *pnbytes)
+{
     while (ma != NULL) {
         if (gc_marked(ma->a)) {
-            nused++;
-            nbytes += array_nbytes(ma->a);
+            (*pnused)++;
+            *pnbytes += array_nbytes(ma->a);
         }
         ma = ma->next;
     }
+}
+
+static void big_obj_stats(void)
+{
+    size_t nused=0, nbytes=0;
+    big_list_stats(big_objects, &nused, &nbytes);
+    big_list_stats(big_objects_old, &nused, &nbytes);
+    malloced_list_stats(mallocarrays, &nused, &nbytes);
+    malloced_list_stats(mallocarrays_old, &nused, &nbytes);
 
     JL_PRINTF(JL_STDOUT, "%d bytes in %d large objects\n", nbytes, nused);
 }
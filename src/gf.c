@@ -20,7 +20,6 @@
 // debugging options
 //#define TRACE_INFERENCE
 //#define JL_TRACE
-//#define JL_GF_PROFILE
 
 static jl_methtable_t *new_method_table(jl_sym_t *name)
 {
@@ -31,11 +30,11 @@ static jl_methtable_t *new_method_table(jl_sym_t *name)
     mt->cache = JL_NULL;
     mt->cache_arg1 = JL_NULL;
     mt->cache_targ = JL_NULL;
+    mt->cache_leaf = JL_NULL;
     mt->max_args = 0;
     mt->kwsorter = NULL;
-#ifdef JL_GF_PROFILE
-    mt->ncalls = 0;
-#endif
+    mt->max_specializations = 0;
+    mt->defs_index = (jl_array_t*)JL_NULL;
     return mt;
 }
 
@@ -202,6 +201,165 @@ static jl_methlist_t **mtcache_hash_bp(jl_array_t **pa, jl_value_t *ty,
     return NULL;
 }
 
+/*
+  Signatures made only of concrete types are also indexed by a hash of
+  the UIDs of all their types (cache_leaf), so that calls with all
+  argument types matching exactly are found without scanning the lists
+  below. It is an open-addressed table of entries that also live in the
+  lists; an entry is added when a scan finds it, and the whole table is
+  dropped when a new method definition invalidates parts of the cache.
+  Values of kinds are left out, since they can also match Type{T}.
+*/
+
+#define LEAFCACHE_PROBES 8
+#define LEAFCACHE_MAXSZ  (1<<16)
+
+static struct {
+    uint64_t leaf_hits;    // found in cache_leaf
+    uint64_t hashed_hits;  // found under cache_arg1 or cache_targ
+    uint64_t list_hits;    // found in the list of everything else
+    uint64_t scanned;      // list entries compared
+    uint64_t misses;
+} gf_cache_stats;
+
+static inline int is_leafcache_type(jl_value_t *t)
+{
+    return jl_is_datatype(t) && ((jl_datatype_t*)t)->uid != 0 &&
+        t != (jl_value_t*)jl_datatype_type && t != (jl_value_t*)jl_uniontype_type &&
+        t != (jl_value_t*)jl_typector_type && t != (jl_value_t*)jl_tvar_type;
+}
+
+static inline uptrint_t leafcache_hash(uptrint_t h, jl_value_t *t)
+{
+    return h*31 + ((jl_datatype_t*)t)->uid;
+}
+
+static jl_methlist_t *leafcache_lookup(jl_array_t *a, jl_value_t **args, size_t n)
+{
+    uptrint_t h = n;
+    size_t i;
+    for(i=0; i < n; i++) {
+        jl_value_t *t = (jl_value_t*)jl_typeof(args[i]);
+        if (!is_leafcache_type(t))
+            return JL_NULL;
+        h = leafcache_hash(h, t);
+    }
+    h = inthash(h);
+    size_t mask = jl_array_len(a)-1;
+    for(size_t p=0; p < LEAFCACHE_PROBES; p++) {
+        jl_methlist_t *ml = (jl_methlist_t*)jl_cellref(a, (h+p) & mask);
+        if (ml == NULL)
+            return JL_NULL;
+        if (jl_tuple_len(ml->sig) == n) {
+            for(i=0; i < n; i++) {
+                if (jl_tupleref(ml->sig, i) != (jl_value_t*)jl_typeof(args[i]))
+                    break;
+            }
+            if (i == n)
+                return ml;
+        }
+    }
+    return JL_NULL;
+}
+
+static jl_methlist_t *leafcache_lookup_by_type(jl_array_t *a, jl_tuple_t *types)
+{
+    size_t n = jl_tuple_len(types);
+    uptrint_t h = n;
+    size_t i;
+    for(i=0; i < n; i++) {
+        jl_value_t *t = jl_tupleref(types, i);
+        if (!is_leafcache_type(t))
+            return JL_NULL;
+        h = leafcache_hash(h, t);
+    }
+    h = inthash(h);
+    size_t mask = jl_array_len(a)-1;
+    for(size_t p=0; p < LEAFCACHE_PROBES; p++) {
+        jl_methlist_t *ml = (jl_methlist_t*)jl_cellref(a, (h+p) & mask);
+        if (ml == NULL)
+            return JL_NULL;
+        if (jl_tuple_len(ml->sig) == n) {
+            for(i=0; i < n; i++) {
+                if (jl_tupleref(ml->sig, i) != jl_tupleref(types, i))
+                    break;
+            }
+            if (i == n)
+                return ml;
+        }
+    }
+    return JL_NULL;
+}
+
+static int leafcache_put(jl_array_t *a, jl_methlist_t *ml)
+{
+    jl_tuple_t *sig = ml->sig;
+    size_t n = jl_tuple_len(sig);
+    uptrint_t h = n;
+    for(size_t i=0; i < n; i++)
+        h = leafcache_hash(h, jl_tupleref(sig, i));
+    h = inthash(h);
+    size_t mask = jl_array_len(a)-1;
+    for(size_t p=0; p < LEAFCACHE_PROBES; p++) {
+        jl_methlist_t **pml = (jl_methlist_t**)&jl_cellref(a, (h+p) & mask);
+        if (*pml == NULL) {
+            *pml = ml;
+            jl_gc_wb(a, ml);
+            return 1;
+        }
+        if (*pml == ml)
+            return 1;
+    }
+    return 0;
+}
+
+// add ml, which exactly matched a call with these arguments, to cache_leaf
+static void leafcache_insert(jl_methtable_t *mt, jl_methlist_t *ml,
+                             jl_value_t **args, size_t n)
+{
+    if (ml->va || jl_tuple_len(ml->sig) != n)
+        return;
+    for(size_t i=0; i < n; i++) {
+        jl_value_t *t = jl_tupleref(ml->sig, i);
+        if (t != (jl_value_t*)jl_typeof(args[i]) || !is_leafcache_type(t))
+            return;
+    }
+    if (mt->cache_leaf == JL_NULL) {
+        mt->cache_leaf = jl_alloc_cell_1d(16);
+        jl_gc_wb(mt, mt->cache_leaf);
+    }
+    while (!leafcache_put(mt->cache_leaf, ml)) {
+        size_t len = jl_array_len(mt->cache_leaf);
+        if (len >= LEAFCACHE_MAXSZ)
+            return;
+        jl_array_t *old = mt->cache_leaf;
+        JL_GC_PUSH1(&old);
+        jl_array_t *a = jl_alloc_cell_1d(len*2);
+        for(size_t i=0; i < len; i++) {
+            jl_methlist_t *e = (jl_methlist_t*)jl_cellref(old, i);
+            if (e != NULL)
+                leafcache_put(a, e);
+        }
+        JL_GC_POP();
+        mt->cache_leaf = a;
+        jl_gc_wb(mt, a);
+    }
+}
+
+DLLEXPORT void jl_gf_cache_stats(uint64_t *out)
+{
+    out[0] = gf_cache_stats.leaf_hits;
+    out[1] = gf_cache_stats.hashed_hits;
+    out[2] = gf_cache_stats.list_hits;
+    out[3] = gf_cache_stats.scanned;
+    out[4] = gf_cache_stats.misses;
+}
+
+DLLEXPORT void jl_gf_cache_stats_reset(void)
+{
+    memset(&gf_cache_stats, 0, sizeof(gf_cache_stats));
+}
+
 /*
   Method caches are divided into three parts: one for signatures where
   the first argument is a singleton kind (Type{Foo}), one indexed by the
@@ -212,6 +370,11 @@ static jl_function_t *jl_method_table_assoc_exact_by_type(jl_methtable_t *mt,
                                                           jl_tuple_t *types)
 {
     jl_methlist_t *ml = JL_NULL;
+    if (mt->cache_leaf != JL_NULL) {
+        ml = leafcache_lookup_by_type(mt->cache_leaf, types);
+        if (ml != JL_NULL)
+            return ml->func;
+    }
     if (jl_tuple_len(types) > 0) {
         jl_value_t *ty = jl_t0(types);
         if (jl_is_type_type(ty)) {
@@ -244,32 +407,27 @@ static jl_function_t *jl_method_table_assoc_exact(jl_methtable_t *mt,
 {
     // NOTE: This function is a huge performance hot spot!!
     jl_methlist_t *ml = JL_NULL;
+    int hashed = 0;
+    if (mt->cache_leaf != JL_NULL) {
+        ml = leafcache_lookup(mt->cache_leaf, args, n);
+        if (ml != JL_NULL) {
+            gf_cache_stats.leaf_hits++;
+            return ml->func;
+        }
+    }
     if (n > 0) {
         jl_value_t *a0 = args[0];
         jl_value_t *ty = (jl_value_t*)jl_typeof(a0);
         if (mt->cache_targ != JL_NULL && ty == (jl_value_t*)jl_datatype_type) {
             ml = mtcache_hash_lookup(mt->cache_targ, a0, 1);
-            if (ml != JL_NULL)
+            if (ml != JL_NULL) {
+                hashed = 1;
                 goto mt_assoc_lkup;
+            }
         }
         if (mt->cache_arg1 != JL_NULL && jl_is_datatype(ty)) {
             ml = mtcache_hash_lookup(mt->cache_arg1, ty, 0);
-            if (ml != JL_NULL) {
-                if (ml->next==JL_NULL && n==1 && jl_tuple_len(ml->sig)==1)
-                    return ml->func;
-                if (n==2) {
-                    // some manually-unrolled common special cases
-                    jl_value_t *a1 = args[1];
-                    jl_methlist_t *mn = ml;
-                    if (jl_tuple_len(mn->sig)==2 &&
-                        jl_tupleref(mn->sig,1)==(jl_value_t*)jl_typeof(a1))
-                        return mn->func;
-                    mn = mn->next;
-                    if (mn!=JL_NULL && jl_tuple_len(mn->sig)==2 &&
-                        jl_tupleref(mn->sig,1)==(jl_value_t*)jl_typeof(a1))
-                        return mn->func;
-                }
-            }
+            hashed = (ml != JL_NULL);
         }
     }
     if (ml == JL_NULL)
@@ -277,14 +435,21 @@ static jl_function_t *jl_method_table_assoc_exact(jl_methtable_t *mt,
  mt_assoc_lkup:
     while (ml != JL_NULL) {
         size_t lensig = jl_tuple_len(ml->sig);
+        gf_cache_stats.scanned++;
         if ((lensig == n || ml->va) &&
             !(lensig > n && n != lensig-1)) {
             if (cache_match(args, n, (jl_tuple_t*)ml->sig, ml->va, lensig)) {
+                if (hashed)
+                    gf_cache_stats.hashed_hits++;
+                else
+                    gf_cache_stats.list_hits++;
+                leafcache_insert(mt, ml, args, n);
                 return ml->func;
             }
         }
         ml = ml->next;
     }
+    gf_cache_stats.misses++;
     return jl_bottom_func;
 }
 
@@ -298,6 +463,8 @@ jl_lambda_info_t *jl_add_static_parameters(jl_lambda_info_t *l, jl_tuple_t *sp)
     jl_lambda_info_t *nli = jl_new_lambda_info(l->ast, sp);
     nli->name = l->name;
     nli->fptr = l->fptr;
+    nli->quickFptr = l->quickFptr;
+    nli->quickCompiled = l->quickCompiled;
     nli->module = l->module;
     nli->file = l->file;
     nli->line = l->line;
@@ -326,15 +493,16 @@ jl_function_t *jl_reinstantiate_method(jl_function_t *f, jl_lambda_info_t *li)
 }
 
 static
-jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_tuple_t *type,
-                                     jl_function_t *method, jl_tuple_t *tvars,
-                                     int check_amb);
+jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_value_t *parent,
+                                     jl_tuple_t *type, jl_function_t *method,
+                                     jl_tuple_t *tvars, int check_amb);
 
 static
 jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
                                       jl_function_t *method)
 {
     jl_methlist_t **pml = &mt->cache;
+    jl_value_t *parent = (jl_value_t*)mt;
     if (jl_tuple_len(type) > 0) {
         jl_value_t *t0 = jl_t0(type);
         uptrint_t uid=0;
@@ -349,6 +517,8 @@ jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
                 if (mt->cache_targ == JL_NULL)
                     mt->cache_targ = jl_alloc_cell_1d(16);
                 pml = mtcache_hash_bp(&mt->cache_targ, a0, 1);
+                jl_gc_wb(mt, mt->cache_targ);
+                parent = (jl_value_t*)mt->cache_targ;
                 goto ml_do_insert;
             }
         }
@@ -358,10 +528,12 @@ jl_function_t *jl_method_cache_insert(jl_methtable_t *mt, jl_tuple_t *type,
             if (mt->cache_arg1 == JL_NULL)
                 mt->cache_arg1 = jl_alloc_cell_1d(16);
             pml = mtcache_hash_bp(&mt->cache_arg1, t0, 0);
+            jl_gc_wb(mt, mt->cache_arg1);
+            parent = (jl_value_t*)mt->cache_arg1;
         }
     }
  ml_do_insert:
-    return jl_method_list_insert(pml, type, method, jl_null, 0)->func;
+    return jl_method_list_insert(pml, parent, type, method, jl_null, 0)->func;
 }
 
 extern jl_function_t *jl_typeinf_func;
@@ -396,6 +568,7 @@ void jl_type_infer(jl_lambda_info_t *li, jl_tuple_t *argtypes,
 #ifdef ENABLE_INFERENCE
         jl_value_t *newast = jl_apply(jl_typeinf_func, fargs, 4);
         li->ast = jl_tupleref(newast, 0);
+        jl_gc_wb(li, li->ast);
         li->inferred = 1;
 #endif
         li->inInference = 0;
@@ -444,6 +617,114 @@ static int is_kind(jl_value_t *v)
 static jl_value_t *ml_matches(jl_methlist_t *ml, jl_value_t *type,
                               jl_sym_t *name, int lim);
 
+/*
+  Specialization limits. Once a method has this many specializations,
+  cache_method widens the signatures of further calls to the types
+  declared by the method wherever those have no typevars, so that one
+  more general specialization serves all of them. 0 means no limit;
+  a generic function's own max_specializations overrides it.
+*/
+DLLEXPORT size_t jl_max_specializations = 0;
+static uint64_t n_widened = 0;
+
+static size_t max_specializations(jl_methtable_t *mt)
+{
+    return mt->max_specializations > 0 ? mt->max_specializations :
+        jl_max_specializations;
+}
+
+// replace the argument types in type with the declared ones where
+// possible. returns whether anything changed.
+static int widen_signature(jl_methtable_t *mt, jl_tuple_t *type,
+                           jl_function_t *method, jl_tuple_t *decl)
+{
+    size_t i, n = jl_tuple_len(type), nd = jl_tuple_len(decl);
+    int changed = 0;
+    // build the widened signature in a fresh tuple, since type may already
+    // have been compared to these definitions
+    jl_tuple_t *w = jl_alloc_tuple(n);
+    JL_GC_PUSH1(&w);
+    for(i=0; i < n; i++) {
+        jl_value_t *elt = jl_tupleref(type,i);
+        jl_tupleset(w, i, elt);
+        if (nd == 0)
+            continue;
+        jl_value_t *declt = jl_tupleref(decl, i < nd ? i : nd-1);
+        if (jl_is_vararg_type(declt))
+            declt = jl_tparam0(declt);
+        else if (i >= nd)
+            continue;
+        if (declt != elt && declt != (jl_value_t*)jl_ANY_flag &&
+            !jl_has_typevars(declt) && !jl_is_vararg_type(elt)) {
+            jl_tupleset(w, i, declt);
+            changed = 1;
+        }
+    }
+    if (changed) {
+        // as for tuple arguments, don't generalize over more specific
+        // definitions with typevars; guard entries can't stand in for those
+        jl_methlist_t *curr = mt->defs;
+        while (curr != JL_NULL && curr->func!=method) {
+            if (curr->tvars!=jl_null &&
+                jl_type_intersection((jl_value_t*)curr->sig, (jl_value_t*)w) !=
+                (jl_value_t*)jl_bottom_type) {
+                changed = 0;
+                break;
+            }
+            curr = curr->next;
+        }
+    }
+    if (changed) {
+        for(i=0; i < n; i++)
+            jl_tupleset(type, i, jl_tupleref(w,i));
+        n_widened++;
+    }
+    JL_GC_POP();
+    return changed;
+}
+
+static size_t methlist_len(jl_methlist_t *ml)
+{
+    size_t n = 0;
+    for(; ml != JL_NULL; ml = ml->next)
+        n++;
+    return n;
+}
+
+static size_t methlist_array_len(jl_array_t *a)
+{
+    size_t i, n = 0;
+    if (a == (jl_array_t*)JL_NULL)
+        return 0;
+    for(i=0; i < jl_array_len(a); i++) {
+        jl_methlist_t *ml = (jl_methlist_t*)jl_cellref(a,i);
+        if (ml != NULL)
+            n += methlist_len(ml);
+    }
+    return n;
+}
+
+// sizes of the caches of generic function f: out[0] is the number of
+// method cache entries, including guard entries, and out[1] the number
+// of specializations of its methods
+DLLEXPORT void jl_method_cache_size(jl_function_t *f, size_t *out)
+{
+    jl_methtable_t *mt = jl_gf_mtable(f);
+    out[0] = methlist_len(mt->cache) + methlist_array_len(mt->cache_arg1) +
+        methlist_array_len(mt->cache_targ);
+    out[1] = 0;
+    for(jl_methlist_t *ml = mt->defs; ml != JL_NULL; ml = ml->next) {
+        if (ml->func->linfo && ml->func->linfo->specializations)
+            out[1] += jl_array_len(ml->func->linfo->specializations);
+    }
+}
+
+// number of signatures widened because of a specialization limit
+DLLEXPORT uint64_t jl_num_widened_specializations(void)
+{
+    return n_widened;
+}
+
 static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
                                    jl_function_t *method, jl_tuple_t *decl,
                                    jl_tuple_t *sparams)
@@ -683,6 +964,15 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
         }
     }
 
+    size_t maxspec = max_specializations(mt);
+    if (maxspec > 0 && method->linfo && method->linfo->specializations &&
+        jl_array_len(method->linfo->specializations) >= maxspec) {
+        // the widened signature may cover arguments that other
+        // definitions should handle
+        if (widen_signature(mt, type, method, decl))
+            need_guard_entries = 1;
+    }
+
     // for varargs methods, only specialize up to max_args.
     // in general, here we want to find the biggest type that's not a
     // supertype of any other method signatures. so far we are conservative
@@ -805,12 +1095,15 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
         if (method->linfo->unspecialized == NULL) {
             method->linfo->unspecialized =
                 jl_instantiate_method(method, jl_null);
+            jl_gc_wb(method->linfo, method->linfo->unspecialized);
         }
         newmeth->linfo->unspecialized = method->linfo->unspecialized;
+        jl_gc_wb(newmeth->linfo, newmeth->linfo->unspecialized);
     }
 
     if (newmeth->linfo != NULL && newmeth->linfo->ast != NULL) {
         newmeth->linfo->specTypes = type;
+        jl_gc_wb(newmeth->linfo, type);
         jl_array_t *spe = method->linfo->specializations;
         if (spe == NULL) {
             spe = jl_alloc_cell_1d(1);
@@ -820,6 +1113,7 @@ static jl_function_t *cache_method(jl_methtable_t *mt, jl_tuple_t *type,
             jl_cell_1d_push(spe, (jl_value_t*)newmeth->linfo);
         }
         method->linfo->specializations = spe;
+        jl_gc_wb(method->linfo, spe);
         jl_type_infer(newmeth->linfo, type, method->linfo);
     }
     JL_GC_POP();
@@ -1021,9 +1315,17 @@ void print_func_loc(JL_STREAM *s, jl_lambda_info_t *li);
   To check this, jl_types_equal_generic needs to be more sophisticated
   so (T,T) is not equivalent to (Any,Any). (TODO)
 */
+
+// ambiguities found while loading a module are queued as
+// (method table, signature, method, other definition) and reported once
+// the outermost module has been loaded, unless definitions added in the
+// meantime resolve them.
+jl_array_t *jl_ambiguity_queue = NULL;
+static int defer_ambiguities = 0;
+
 static void check_ambiguous(jl_methlist_t *ml, jl_tuple_t *type,
-                            jl_methlist_t *oldmeth, jl_sym_t *fname,
-                            jl_lambda_info_t *linfo)
+                            jl_methlist_t *oldmeth, jl_function_t *method,
+                            jl_value_t *parent)
 {
     jl_tuple_t *sig = oldmeth->sig;
     size_t tl = jl_tuple_len(type);
@@ -1050,7 +1352,17 @@ static void check_ambiguous(jl_methlist_t *ml, jl_tuple_t *type,
                 goto done_chk_amb;  // ok, intersection is covered
             l = l->next;
         }
-        char *n = fname->name;
+        if (defer_ambiguities > 0 && parent != NULL) {
+            if (jl_ambiguity_queue == NULL)
+                jl_ambiguity_queue = jl_alloc_cell_1d(0);
+            jl_cell_1d_push(jl_ambiguity_queue, parent);
+            jl_cell_1d_push(jl_ambiguity_queue, (jl_value_t*)type);
+            jl_cell_1d_push(jl_ambiguity_queue, (jl_value_t*)method);
+            jl_cell_1d_push(jl_ambiguity_queue, (jl_value_t*)oldmeth);
+            goto done_chk_amb;
+        }
+        jl_lambda_info_t *linfo = method->linfo;
+        char *n = (linfo ? linfo->name : anonymous_sym)->name;
         jl_value_t *errstream = jl_stderr_obj();
         JL_STREAM *s = JL_STDERR;
         JL_PRINTF(s, "Warning: New definition \n    %s", n);
@@ -1067,6 +1379,69 @@ static void check_ambiguous(jl_methlist_t *ml, jl_tuple_t *type,
     }
 }
 
+// called with 1 before and 0 after loading a module. leaving the
+// outermost module reports the ambiguities that are still unresolved.
+void jl_defer_ambiguity_warnings(int defer)
+{
+    if (defer) {
+        defer_ambiguities++;
+        return;
+    }
+    assert(defer_ambiguities > 0);
+    if (--defer_ambiguities > 0 || jl_ambiguity_queue == NULL)
+        return;
+    jl_array_t *q = jl_ambiguity_queue;
+    jl_ambiguity_queue = NULL;
+    JL_GC_PUSH1(&q);
+    for(size_t i=0; i < jl_array_len(q); i+=4) {
+        jl_methtable_t *mt = (jl_methtable_t*)jl_cellref(q,i);
+        check_ambiguous(mt->defs, (jl_tuple_t*)jl_cellref(q,i+1),
+                        (jl_methlist_t*)jl_cellref(q,i+3),
+                        (jl_function_t*)jl_cellref(q,i+2), NULL);
+    }
+    JL_GC_POP();
+}
+
+// whether the first arguments of two signatures cannot match the same
+// value. this is cheap, and lets definitions skip most of the specificity,
+// ambiguity and cache checks against unrelated methods: two datatypes can
+// only have a common subtype if one's name is among the other's supertypes.
+static jl_value_t *sig_arg1(jl_tuple_t *sig)
+{
+    if (jl_tuple_len(sig) == 0)
+        return NULL;
+    jl_value_t *t = jl_tupleref(sig,0);
+    if (jl_is_vararg_type(t))
+        return NULL;
+    while (jl_is_typevar(t))
+        t = ((jl_tvar_t*)t)->ub;
+    if (jl_is_typector(t))
+        t = (jl_value_t*)((jl_typector_t*)t)->body;
+    if (!jl_is_datatype(t) || jl_is_type_type(t))
+        return NULL;
+    return t;
+}
+
+static int has_super_named(jl_datatype_t *t, jl_typename_t *name)
+{
+    while (1) {
+        if (t->name == name)
+            return 1;
+        if (t == jl_any_type)
+            return 0;
+        t = t->super;
+    }
+}
+
+static int sig_arg1_disjoint(jl_tuple_t *a, jl_tuple_t *b)
+{
+    jl_datatype_t *ta = (jl_datatype_t*)sig_arg1(a);
+    jl_datatype_t *tb = (jl_datatype_t*)sig_arg1(b);
+    if (ta == NULL || tb == NULL || ta->name == tb->name)
+        return 0;
+    return !has_super_named(ta, tb->name) && !has_super_named(tb, ta->name);
+}
+
 static int has_unions(jl_tuple_t *type)
 {
     int i;
@@ -1079,114 +1454,393 @@ static int has_unions(jl_tuple_t *type)
     return 0;
 }
 
+// replace the method of l, whose signature is equal to type
+static jl_methlist_t *methlist_overwrite(jl_methlist_t **pml, jl_methlist_t *l,
+                                         jl_tuple_t *type, jl_function_t *method,
+                                         jl_tuple_t *tvars, int check_amb)
+{
+    if (check_amb && l->func->linfo && method->linfo &&
+        (l->func->linfo->module != method->linfo->module) &&
+        // special case: allow adding Array() methods in Base
+        (pml != &((jl_methtable_t*)jl_array_type->env)->defs ||
+         method->linfo->module != jl_base_module)) {
+        jl_module_t *newmod = method->linfo->module;
+        jl_value_t *errstream = jl_stderr_obj();
+        JL_STREAM *s = JL_STDERR;
+        JL_PRINTF(s, "Warning: Method definition %s", method->linfo->name->name);
+        jl_show(errstream, (jl_value_t*)type);
+        JL_PRINTF(s, " in module %s", l->func->linfo->module->name->name);
+        print_func_loc(s, l->func->linfo);
+        JL_PRINTF(s, " overwritten in module %s", newmod->name->name);
+        print_func_loc(s, method->linfo);
+        JL_PRINTF(s, ".\n");
+    }
+    JL_SIGATOMIC_BEGIN();
+    l->sig = type;
+    l->tvars = tvars;
+    l->va = (jl_tuple_len(type) > 0 &&
+             jl_is_vararg_type(jl_tupleref(type,jl_tuple_len(type)-1))) ?
+        1 : 0;
+    l->invokes = JL_NULL;
+    // inline caches may still call the method being replaced
+    if (l->func != method)
+        jl_ic_epoch++;
+    l->func = method;
+    jl_gc_wb(l, type);
+    jl_gc_wb(l, tvars);
+    jl_gc_wb(l, method);
+    JL_SIGATOMIC_END();
+    return l;
+}
+
+static jl_methlist_t *methlist_new(jl_tuple_t *type, jl_function_t *method,
+                                   jl_tuple_t *tvars)
+{
+    jl_methlist_t *newrec = (jl_methlist_t*)allocobj(sizeof(jl_methlist_t));
+    newrec->type = (jl_value_t*)jl_method_type;
+    newrec->sig = type;
+    newrec->tvars = tvars;
+    newrec->va = (jl_tuple_len(type) > 0 &&
+                  jl_is_vararg_type(jl_tupleref(type,jl_tuple_len(type)-1))) ?
+        1 : 0;
+    newrec->func = method;
+    newrec->invokes = JL_NULL;
+    newrec->next = JL_NULL;
+    newrec->rank = 0;
+    return newrec;
+}
+
+// if the signature of newrec contains Union types, methods after it might
+// actually be more specific than it. we need to re-sort them.
+static void methlist_resort_unions(jl_methlist_t **pml, jl_value_t *parent,
+                                   jl_methlist_t *newrec)
+{
+    jl_methlist_t *l, **pl;
+    jl_methlist_t *item = newrec->next, *next;
+    jl_methlist_t **pitem = &newrec->next, **pnext;
+    while (item != JL_NULL) {
+        pl = pml;
+        l = *pml;
+        next = item->next;
+        pnext = &item->next;
+        while (l != newrec->next) {
+            if (jl_args_morespecific((jl_value_t*)item->sig,
+                                     (jl_value_t*)l->sig)) {
+                // reinsert item earlier in the list
+                *pitem = next;
+                item->next = l;
+                *pl = item;
+                pnext = pitem;
+                break;
+            }
+            pl = &l->next;
+            l = l->next;
+        }
+        item = next;
+        pitem = pnext;
+    }
+    // the list was relinked in place
+    jl_gc_wb(parent, *pml);
+    for(l = *pml; l != JL_NULL; l = l->next)
+        jl_gc_wb(l, l->next);
+}
+
+// insert into the list at *pml, which is a field of `parent`
 static
-jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_tuple_t *type,
-                                     jl_function_t *method, jl_tuple_t *tvars,
-                                     int check_amb)
+jl_methlist_t *jl_method_list_insert(jl_methlist_t **pml, jl_value_t *parent,
+                                     jl_tuple_t *type, jl_function_t *method,
+                                     jl_tuple_t *tvars, int check_amb)
 {
     jl_methlist_t *l, **pl;
+    jl_value_t *pa;
 
     assert(jl_is_tuple(type));
     l = *pml;
     while (l != JL_NULL) {
         if (((l->tvars==jl_null) == (tvars==jl_null)) &&
+            !sig_arg1_disjoint(type, l->sig) &&
             sigs_eq((jl_value_t*)type, (jl_value_t*)l->sig, 1)) {
             // method overwritten
-            if (check_amb && l->func->linfo && method->linfo &&
-                (l->func->linfo->module != method->linfo->module) &&
-                // special case: allow adding Array() methods in Base
-                (pml != &((jl_methtable_t*)jl_array_type->env)->defs ||
-                 method->linfo->module != jl_base_module)) {
-                jl_module_t *newmod = method->linfo->module;
-                jl_value_t *errstream = jl_stderr_obj();
-                JL_STREAM *s = JL_STDERR;
-                JL_PRINTF(s, "Warning: Method definition %s", method->linfo->name->name);
-                jl_show(errstream, (jl_value_t*)type);
-                JL_PRINTF(s, " in module %s", l->func->linfo->module->name->name);
-                print_func_loc(s, l->func->linfo);
-                JL_PRINTF(s, " overwritten in module %s", newmod->name->name);
-                print_func_loc(s, method->linfo);
-                JL_PRINTF(s, ".\n");
-            }
-            JL_SIGATOMIC_BEGIN();
-            l->sig = type;
-            l->tvars = tvars;
-            l->va = (jl_tuple_len(type) > 0 &&
-                     jl_is_vararg_type(jl_tupleref(type,jl_tuple_len(type)-1))) ?
-                1 : 0;
-            l->invokes = JL_NULL;
-            l->func = method;
-            JL_SIGATOMIC_END();
-            return l;
+            return methlist_overwrite(pml, l, type, method, tvars, check_amb);
         }
         l = l->next;
     }
     pl = pml;
+    pa = parent;
     l = *pml;
     while (l != JL_NULL) {
+        // methods that can't apply to the same arguments need no ordering
+        if (sig_arg1_disjoint(type, l->sig)) {
+            pl = &l->next;
+            pa = (jl_value_t*)l;
+            l = l->next;
+            continue;
+        }
         if (jl_args_morespecific((jl_value_t*)type, (jl_value_t*)l->sig))
             break;
-        if (check_amb) {
-            check_ambiguous(*pml, type, l,
-                            method->linfo ? method->linfo->name :
-                            anonymous_sym, method->linfo);
-        }
+        if (check_amb)
+            check_ambiguous(*pml, type, l, method, parent);
         pl = &l->next;
+        pa = (jl_value_t*)l;
         l = l->next;
     }
-    jl_methlist_t *newrec = (jl_methlist_t*)allocobj(sizeof(jl_methlist_t));
-    newrec->type = (jl_value_t*)jl_method_type;
-    newrec->sig = type;
-    newrec->tvars = tvars;
-    newrec->va = (jl_tuple_len(type) > 0 &&
-                  jl_is_vararg_type(jl_tupleref(type,jl_tuple_len(type)-1))) ?
-        1 : 0;
-    newrec->func = method;
-    newrec->invokes = JL_NULL;
+    jl_methlist_t *newrec = methlist_new(type, method, tvars);
     newrec->next = l;
     JL_SIGATOMIC_BEGIN();
     *pl = newrec;
-    // if this contains Union types, methods after it might actually be
-    // more specific than it. we need to re-sort them.
-    if (has_unions(type)) {
-        jl_methlist_t *item = newrec->next, *next;
-        jl_methlist_t **pitem = &newrec->next, **pnext;
-        while (item != JL_NULL) {
-            pl = pml;
-            l = *pml;
-            next = item->next;
-            pnext = &item->next;
-            while (l != newrec->next) {
-                if (jl_args_morespecific((jl_value_t*)item->sig,
-                                         (jl_value_t*)l->sig)) {
-                    // reinsert item earlier in the list
-                    *pitem = next;
-                    item->next = l;
-                    *pl = item;
-                    pnext = pitem;
+    jl_gc_wb(pa, newrec);
+    if (has_unions(type))
+        methlist_resort_unions(pml, parent, newrec);
+    JL_SIGATOMIC_END();
+    return newrec;
+}
+
+/*
+  Definitions are indexed by the name of their first argument type, so
+  that adding one only visits the definitions it can be ordered against.
+  mt->defs_index is a list of buckets, each holding the definitions with
+  one such name in the order of mt->defs, i.e. by specificity. Signatures
+  whose first argument is Any, a typevar, Type{...}, a union or a vararg,
+  or that have no arguments, share the bucket of Any. Every definition
+  has a rank that increases along mt->defs, to compare positions in
+  different buckets.
+
+  A new definition whose first argument is a datatype A can only be more
+  specific than definitions in the buckets of the names of A and its
+  supertypes, the shared bucket among them. It goes before the first of
+  those it is more specific than, right after the last definition before
+  that one which it overlaps with. The overlapping definitions, which are
+  the ones checked for ambiguity, are in the same buckets or in those of
+  A's subtypes; other buckets are skipped by name. A new definition in
+  the shared bucket is still compared with every definition.
+
+  The index is rebuilt from mt->defs when it is missing, e.g. after a
+  definition with unions re-sorted the list.
+*/
+#ifdef _P64
+#define DEFS_RANK_GAP ((ptrint_t)1<<32)
+#else
+#define DEFS_RANK_GAP ((ptrint_t)1<<16)
+#endif
+#define DEFS_RANK_MAX ((ptrint_t)(((uptrint_t)-1)>>2))
+
+static jl_typename_t *defs_bucket_name(jl_tuple_t *sig)
+{
+    if (jl_tuple_len(sig) > 0) {
+        jl_value_t *t = jl_tupleref(sig,0);
+        if (jl_is_datatype(t) && !jl_is_type_type(t) && !jl_is_vararg_type(t))
+            return ((jl_datatype_t*)t)->name;
+    }
+    return jl_any_type->name;
+}
+
+#define defs_bucket_first(b) ((jl_methlist_t*)jl_cellref(b,0))
+
+static void defs_renumber(jl_methtable_t *mt)
+{
+    size_t n = 0;
+    jl_methlist_t *l;
+    for(l = mt->defs; l != JL_NULL; l = l->next)
+        n++;
+    ptrint_t gap = DEFS_RANK_MAX/(ptrint_t)(n+1);
+    if (gap > DEFS_RANK_GAP)
+        gap = DEFS_RANK_GAP;
+    ptrint_t r = 0;
+    for(l = mt->defs; l != JL_NULL; l = l->next) {
+        l->rank = r;
+        r += gap;
+    }
+}
+
+// give l, just linked into mt->defs after pred (NULL for the front), a rank
+// between those of its neighbors, renumbering the list if there is no room
+static void defs_set_rank(jl_methtable_t *mt, jl_methlist_t *pred,
+                          jl_methlist_t *l)
+{
+    jl_methlist_t *next = l->next;
+    if (pred == NULL && next == JL_NULL) {
+        l->rank = 0;
+        return;
+    }
+    if (pred == NULL) {
+        if (next->rank > DEFS_RANK_GAP - DEFS_RANK_MAX) {
+            l->rank = next->rank - DEFS_RANK_GAP;
+            return;
+        }
+    }
+    else if (next == JL_NULL) {
+        if (pred->rank < DEFS_RANK_MAX - DEFS_RANK_GAP) {
+            l->rank = pred->rank + DEFS_RANK_GAP;
+            return;
+        }
+    }
+    else if (next->rank - pred->rank > 1) {
+        l->rank = pred->rank + (next->rank - pred->rank)/2;
+        return;
+    }
+    defs_renumber(mt);
+}
+
+// add l to its bucket, after the definitions ranked before it
+static void defs_index_add(jl_methtable_t *mt, jl_methlist_t *l)
+{
+    jl_typename_t *name = defs_bucket_name(l->sig);
+    jl_array_t *idx = mt->defs_index;
+    jl_array_t *b = NULL;
+    size_t i;
+    for(i=0; i < jl_array_len(idx); i++) {
+        b = (jl_array_t*)jl_cellref(idx,i);
+        if (defs_bucket_name(defs_bucket_first(b)->sig) == name)
+            break;
+    }
+    if (i == jl_array_len(idx)) {
+        b = jl_alloc_cell_1d(0);
+        JL_GC_PUSH1(&b);
+        jl_cell_1d_push(b, (jl_value_t*)l);
+        jl_cell_1d_push(idx, (jl_value_t*)b);
+        JL_GC_POP();
+        return;
+    }
+    size_t lo = 0, hi = jl_array_len(b);
+    while (lo < hi) {
+        size_t mid = (lo+hi)/2;
+        if (((jl_methlist_t*)jl_cellref(b,mid))->rank < l->rank)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    jl_array_grow_end(b, 1);
+    jl_value_t **d = (jl_value_t**)b->data;
+    memmove(&d[lo+1], &d[lo], (jl_array_len(b)-1-lo)*sizeof(void*));
+    jl_cellset(b, lo, l);
+}
+
+static void defs_index_rebuild(jl_methtable_t *mt)
+{
+    mt->defs_index = jl_alloc_cell_1d(0);
+    jl_gc_wb(mt, mt->defs_index);
+    defs_renumber(mt);
+    for(jl_methlist_t *l = mt->defs; l != JL_NULL; l = l->next)
+        defs_index_add(mt, l);
+}
+
+static jl_methlist_t *jl_method_defs_insert(jl_methtable_t *mt, jl_tuple_t *type,
+                                            jl_function_t *method,
+                                            jl_tuple_t *tvars)
+{
+    jl_methlist_t *l, *pred = NULL;
+    jl_array_t *b;
+    size_t i, j;
+
+    assert(jl_is_tuple(type));
+    if (mt->defs_index == JL_NULL)
+        defs_index_rebuild(mt);
+    jl_array_t *idx = mt->defs_index;
+    jl_typename_t *name = defs_bucket_name(type);
+    // an equal signature has the same first argument
+    for(j=0; j < jl_array_len(idx); j++) {
+        b = (jl_array_t*)jl_cellref(idx,j);
+        if (defs_bucket_name(defs_bucket_first(b)->sig) != name)
+            continue;
+        for(i=0; i < jl_array_len(b); i++) {
+            l = (jl_methlist_t*)jl_cellref(b,i);
+            if (((l->tvars==jl_null) == (tvars==jl_null)) &&
+                sigs_eq((jl_value_t*)type, (jl_value_t*)l->sig, 1))
+                return methlist_overwrite(&mt->defs, l, type, method, tvars, 1);
+        }
+        break;
+    }
+    if (name == jl_any_type->name) {
+        // this may be more specific than any other definition
+        for(l = mt->defs; l != JL_NULL; l = l->next) {
+            if (!sig_arg1_disjoint(type, l->sig)) {
+                if (jl_args_morespecific((jl_value_t*)type, (jl_value_t*)l->sig))
+                    break;
+                check_ambiguous(mt->defs, type, l, method, (jl_value_t*)mt);
+            }
+            pred = l;
+        }
+    }
+    else {
+        jl_datatype_t *a0 = (jl_datatype_t*)jl_tupleref(type,0);
+        // the first definition this one is more specific than, which has
+        // a supertype of a0 first
+        jl_methlist_t *first = NULL;
+        for(j=0; j < jl_array_len(idx); j++) {
+            b = (jl_array_t*)jl_cellref(idx,j);
+            if (!has_super_named(a0, defs_bucket_name(defs_bucket_first(b)->sig)))
+                continue;
+            for(i=0; i < jl_array_len(b); i++) {
+                l = (jl_methlist_t*)jl_cellref(b,i);
+                if (first != NULL && l->rank >= first->rank)
+                    break;
+                if (!sig_arg1_disjoint(type, l->sig) &&
+                    jl_args_morespecific((jl_value_t*)type, (jl_value_t*)l->sig)) {
+                    first = l;
                     break;
                 }
-                pl = &l->next;
-                l = l->next;
             }
-            item = next;
-            pitem = pnext;
         }
+        // the overlapping definitions before it, which have a supertype or
+        // a subtype of a0 first
+        for(j=0; j < jl_array_len(idx); j++) {
+            b = (jl_array_t*)jl_cellref(idx,j);
+            jl_typename_t *bname = defs_bucket_name(defs_bucket_first(b)->sig);
+            if (!has_super_named(a0, bname) &&
+                !has_super_named((jl_datatype_t*)jl_tupleref(defs_bucket_first(b)->sig,0),
+                                 name))
+                continue;
+            for(i=0; i < jl_array_len(b); i++) {
+                l = (jl_methlist_t*)jl_cellref(b,i);
+                if (first != NULL && l->rank >= first->rank)
+                    break;
+                if (sig_arg1_disjoint(type, l->sig))
+                    continue;
+                check_ambiguous(mt->defs, type, l, method, (jl_value_t*)mt);
+                if (pred == NULL || l->rank > pred->rank)
+                    pred = l;
+            }
+        }
+    }
+    jl_methlist_t *newrec = methlist_new(type, method, tvars);
+    JL_SIGATOMIC_BEGIN();
+    if (pred == NULL) {
+        newrec->next = mt->defs;
+        mt->defs = newrec;
+        jl_gc_wb(mt, newrec);
+    }
+    else {
+        newrec->next = pred->next;
+        pred->next = newrec;
+        jl_gc_wb(pred, newrec);
+    }
+    if (has_unions(type)) {
+        methlist_resort_unions(&mt->defs, (jl_value_t*)mt, newrec);
+        // the ranks and buckets may no longer follow the list
+        mt->defs_index = (jl_array_t*)JL_NULL;
+    }
+    else {
+        defs_set_rank(mt, pred, newrec);
+        defs_index_add(mt, newrec);
     }
     JL_SIGATOMIC_END();
     return newrec;
 }
 
-static void remove_conflicting(jl_methlist_t **pl, jl_value_t *type)
+static void remove_conflicting(jl_methlist_t **pl, jl_value_t *parent,
+                               jl_value_t *type)
 {
     jl_methlist_t *l = *pl;
     while (l != JL_NULL) {
-        if (jl_type_intersection(type, (jl_value_t*)l->sig) !=
+        if (!sig_arg1_disjoint((jl_tuple_t*)type, l->sig) &&
+            jl_type_intersection(type, (jl_value_t*)l->sig) !=
             (jl_value_t*)jl_bottom_type) {
             *pl = l->next;
+            jl_gc_wb(parent, l->next);
         }
         else {
             pl = &l->next;
+            parent = (jl_value_t*)l;
         }
         l = l->next;
     }
@@ -1198,21 +1852,25 @@ jl_methlist_t *jl_method_table_insert(jl_methtable_t *mt, jl_tuple_t *type,
     if (jl_tuple_len(tvars) == 1)
         tvars = (jl_tuple_t*)jl_t0(tvars);
     JL_SIGATOMIC_BEGIN();
-    jl_methlist_t *ml = jl_method_list_insert(&mt->defs,type,method,tvars,1);
+    jl_methlist_t *ml = jl_method_defs_insert(mt, type, method, tvars);
     // invalidate cached methods that overlap this definition
-    remove_conflicting(&mt->cache, (jl_value_t*)type);
+    mt->cache_leaf = JL_NULL;
+    jl_ic_epoch++;
+    remove_conflicting(&mt->cache, (jl_value_t*)mt, (jl_value_t*)type);
     if (mt->cache_arg1 != JL_NULL) {
         for(int i=0; i < jl_array_len(mt->cache_arg1); i++) {
             jl_methlist_t **pl = (jl_methlist_t**)&jl_cellref(mt->cache_arg1,i);
             if (*pl && *pl != JL_NULL)
-                remove_conflicting(pl, (jl_value_t*)type);
+                remove_conflicting(pl, (jl_value_t*)mt->cache_arg1,
+                                   (jl_value_t*)type);
         }
     }
     if (mt->cache_targ != JL_NULL) {
         for(int i=0; i < jl_array_len(mt->cache_targ); i++) {
             jl_methlist_t **pl = (jl_methlist_t**)&jl_cellref(mt->cache_targ,i);
             if (*pl && *pl != JL_NULL)
-                remove_conflicting(pl, (jl_value_t*)type);
+                remove_conflicting(pl, (jl_value_t*)mt->cache_targ,
+                                   (jl_value_t*)type);
         }
     }
     // update max_args
@@ -1325,17 +1983,105 @@ static void show_call(jl_value_t *F, jl_value_t **args, uint32_t nargs)
 }
 #endif
 
-JL_CALLABLE(jl_apply_generic)
+/*
+  Dispatch profiler. While it runs, every call that goes through
+  jl_apply_generic is counted against the method table of the function
+  called, along with whether the method cache had the answer, whether
+  the slow path (jl_mt_assoc_by_type, which may specialize and run type
+  inference) was taken, the time spent there, and whether the method
+  still had to be compiled. Inline caches are bypassed while it runs, so
+  that their calls are seen too; calls that codegen bound directly to a
+  specialized method are not dispatched and so are not counted.
+*/
+typedef struct {
+    uint64_t calls;
+    uint64_t hits;
+    uint64_t slow;
+    uint64_t compiles;
+    double time;
+} gf_prof_t;
+
+static int gf_prof_on = 0;
+static htable_t gf_prof_index;   // method table -> 1 + index into gf_prof
+static gf_prof_t *gf_prof = NULL;
+static size_t gf_prof_max = 0;
+// the method tables profiled, in the order of gf_prof
+jl_array_t *jl_dispatch_profile_tables = NULL;
+
+static gf_prof_t *gf_prof_entry(jl_methtable_t *mt)
 {
-    jl_methtable_t *mt = jl_gf_mtable(F);
-#ifdef JL_GF_PROFILE
-    mt->ncalls++;
-#endif
-#ifdef JL_TRACE
-    if (trace_en) {
-        show_call(F, args, nargs);
+    void *i = ptrhash_get(&gf_prof_index, mt);
+    if (i != HT_NOTFOUND)
+        return &gf_prof[(size_t)i-1];
+    if (jl_dispatch_profile_tables == NULL)
+        jl_dispatch_profile_tables = jl_alloc_cell_1d(0);
+    jl_cell_1d_push(jl_dispatch_profile_tables, (jl_value_t*)mt);
+    size_t n = jl_array_len(jl_dispatch_profile_tables)-1;
+    if (n >= gf_prof_max) {
+        gf_prof_max = gf_prof_max ? gf_prof_max*2 : 64;
+        gf_prof = (gf_prof_t*)realloc(gf_prof, gf_prof_max*sizeof(gf_prof_t));
     }
-#endif
+    memset(&gf_prof[n], 0, sizeof(gf_prof_t));
+    ptrhash_put(&gf_prof_index, mt, (void*)(n+1));
+    return &gf_prof[n];
+}
+
+DLLEXPORT void jl_dispatch_profile_start(void)
+{
+    if (gf_prof_on)
+        return;
+    if (gf_prof_index.size == 0)
+        htable_new(&gf_prof_index, 0);
+    gf_prof_on = 1;
+    // empty every inline cache, and keep them from being refilled
+    jl_ic_epoch++;
+}
+
+DLLEXPORT void jl_dispatch_profile_stop(void)
+{
+    gf_prof_on = 0;
+}
+
+DLLEXPORT int jl_dispatch_profile_is_running(void)
+{
+    return gf_prof_on;
+}
+
+DLLEXPORT void jl_dispatch_profile_clear(void)
+{
+    if (gf_prof_index.size != 0)
+        htable_reset(&gf_prof_index, 0);
+    jl_dispatch_profile_tables = NULL;
+}
+
+// the method tables that were called, for jl_dispatch_profile_counts
+DLLEXPORT jl_value_t *jl_dispatch_profile_get_tables(void)
+{
+    if (jl_dispatch_profile_tables == NULL)
+        return (jl_value_t*)jl_alloc_cell_1d(0);
+    return (jl_value_t*)jl_dispatch_profile_tables;
+}
+
+// for each of the first n tables: calls, cache hits, slow-path lookups
+// and compilations into counts[4i..4i+3], and seconds spent in the slow
+// path into times[i]
+DLLEXPORT void jl_dispatch_profile_counts(uint64_t *counts, double *times, size_t n)
+{
+    for(size_t i=0; i < n; i++) {
+        counts[4*i]   = gf_prof[i].calls;
+        counts[4*i+1] = gf_prof[i].hits;
+        counts[4*i+2] = gf_prof[i].slow;
+        counts[4*i+3] = gf_prof[i].compiles;
+        times[i] = gf_prof[i].time;
+    }
+}
+
+// the method a call to generic function F with these arguments runs, or
+// jl_bottom_func if there is none
+static inline jl_function_t *jl_gf_dispatch(jl_methtable_t *mt,
+                                            jl_value_t **args, size_t nargs,
+                                            gf_prof_t *prof)
+{
     /*
       search order:
       look at concrete signatures
@@ -1347,6 +2093,7 @@ JL_CALLABLE(jl_apply_generic)
     */
     jl_function_t *mfunc = jl_method_table_assoc_exact(mt, args, nargs);
     if (mfunc != jl_bottom_func) {
+        if (prof) prof->hits++;
         if (mfunc->linfo != NULL && 
             (mfunc->linfo->inInference || mfunc->linfo->inCompile)) {
             // if inference is running on this function, return a copy
@@ -1354,16 +2101,41 @@ JL_CALLABLE(jl_apply_generic)
             jl_lambda_info_t *li = mfunc->linfo;
             if (li->unspecialized == NULL) {
                 li->unspecialized = jl_instantiate_method(mfunc, li->sparams);
+                jl_gc_wb(li, li->unspecialized);
             }
             mfunc = li->unspecialized;
         }
     }
     else {
+        double t0 = prof ? clock_now() : 0;
         jl_tuple_t *tt = arg_type_tuple(args, nargs);
         JL_GC_PUSH1(&tt);
         mfunc = jl_mt_assoc_by_type(mt, tt, 1, 0);
         JL_GC_POP();
+        if (prof) {
+            // the entry may have moved if the lookup profiled other calls
+            prof = gf_prof_entry(mt);
+            prof->slow++;
+            prof->time += clock_now()-t0;
+        }
     }
+    return mfunc;
+}
+
+JL_CALLABLE(jl_apply_generic)
+{
+    jl_methtable_t *mt = jl_gf_mtable(F);
+#ifdef JL_TRACE
+    if (trace_en) {
+        show_call(F, args, nargs);
+    }
+#endif
+    gf_prof_t *prof = NULL;
+    if (gf_prof_on) {
+        prof = gf_prof_entry(mt);
+        prof->calls++;
+    }
+    jl_function_t *mfunc = jl_gf_dispatch(mt, args, nargs, prof);
 
     if (mfunc == jl_bottom_func) {
 #ifdef JL_TRACE
@@ -1374,7 +2146,87 @@ JL_CALLABLE(jl_apply_generic)
         return jl_no_method_error((jl_function_t*)F, args, nargs);
     }
     assert(!mfunc->linfo || !mfunc->linfo->inInference);
+    if (gf_prof_on && mfunc->fptr == &jl_trampoline)
+        gf_prof_entry(mt)->compiles++;
+
+    return jl_apply(mfunc, args, nargs);
+}
 
+/*
+  Call-site inline caches. Generated code calling a known generic
+  function it could not specialize gets a table of JL_IC_ENTRIES entries,
+  each mapping the exact argument types of a call to the method it
+  dispatched to:
+    epoch, func_0, types_0[nargs], func_1, types_1[nargs], ...
+  The generated code checks the first entry itself and otherwise calls
+  jl_apply_generic_ic, which checks the others, moving a hit to the front,
+  and adds new entries at the front. The table is emptied when it finds
+  that jl_ic_epoch has changed, which jl_method_table_insert does.
+
+  Only calls whose argument types are all concrete non-kinds are entered
+  (see is_leafcache_type), since those types are kept alive by their
+  type caches, and only methods that the method cache holds, which keeps
+  them alive until the epoch changes. A cache entry is dropped only by
+  remove_conflicting and by methlist_overwrite replacing the method of
+  an existing signature, and both bump the epoch.
+
+  Methods are entered only once they are compiled and not being inferred
+  or compiled again, since the hit paths call them directly, without the
+  checks jl_gf_dispatch makes: calling jl_trampoline from a re-entrant
+  call would compile a function whose inference has not finished.
+*/
+DLLEXPORT size_t jl_ic_epoch = 1;
+
+DLLEXPORT jl_value_t *jl_apply_generic_ic(jl_function_t *F, jl_value_t **args,
+                                          uint32_t nargs, jl_value_t **ic)
+{
+    if (gf_prof_on)
+        return jl_apply_generic((jl_value_t*)F, args, nargs);
+    size_t esz = nargs+1;
+    size_t i, e;
+    if ((size_t)ic[0] != jl_ic_epoch) {
+        memset(&ic[1], 0, JL_IC_ENTRIES*esz*sizeof(void*));
+        ic[0] = (jl_value_t*)jl_ic_epoch;
+    }
+    else {
+        for(e=1; e < JL_IC_ENTRIES; e++) {
+            jl_value_t **ent = &ic[1+e*esz];
+            if (ent[0] == NULL)
+                break;
+            for(i=0; i < nargs; i++) {
+                if (ent[1+i] != (jl_value_t*)jl_typeof(args[i]))
+                    break;
+            }
+            if (i == nargs) {
+                jl_function_t *mfunc = (jl_function_t*)ent[0];
+                {
+                    jl_value_t *tmp[JL_IC_MAX_ARGS+1];
+                    memcpy(tmp, ent, esz*sizeof(void*));
+                    memmove(&ic[1+esz], &ic[1], e*esz*sizeof(void*));
+                    memcpy(&ic[1], tmp, esz*sizeof(void*));
+                }
+                return jl_apply(mfunc, args, nargs);
+            }
+        }
+    }
+    jl_methtable_t *mt = jl_gf_mtable(F);
+    jl_function_t *mfunc = jl_gf_dispatch(mt, args, nargs, NULL);
+    if (mfunc == jl_bottom_func)
+        return jl_no_method_error(F, args, nargs);
+    for(i=0; i < nargs; i++) {
+        if (!is_leafcache_type((jl_value_t*)jl_typeof(args[i])))
+            break;
+    }
+    if (i == nargs && nargs <= JL_IC_MAX_ARGS &&
+        mfunc->fptr != &jl_trampoline &&
+        (mfunc->linfo == NULL ||
+         !(mfunc->linfo->inInference || mfunc->linfo->inCompile)) &&
+        jl_method_table_assoc_exact(mt, args, nargs) == mfunc) {
+        memmove(&ic[1+esz], &ic[1], (JL_IC_ENTRIES-1)*esz*sizeof(void*));
+        ic[1] = (jl_value_t*)mfunc;
+        for(i=0; i < nargs; i++)
+            ic[2+i] = (jl_value_t*)jl_typeof(args[i]);
+    }
     return jl_apply(mfunc, args, nargs);
 }
 
@@ -1431,6 +2283,7 @@ jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
             jl_lambda_info_t *li = mfunc->linfo;
             if (li->unspecialized == NULL) {
                 li->unspecialized = jl_instantiate_method(mfunc, li->sparams);
+                jl_gc_wb(li, li->unspecialized);
             }
             mfunc = li->unspecialized;
         }
@@ -1443,8 +2296,10 @@ jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
 
         if (m->invokes == JL_NULL) {
             m->invokes = new_method_table(mt->name);
+            jl_gc_wb(m, m->invokes);
             // this private method table has just this one definition
-            jl_method_list_insert(&m->invokes->defs,m->sig,m->func,m->tvars,0);
+            jl_method_list_insert(&m->invokes->defs,(jl_value_t*)m->invokes,
+                                  m->sig,m->func,m->tvars,0);
         }
 
         tt = arg_type_tuple(args, nargs);
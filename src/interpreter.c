@@ -136,6 +136,7 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
             jl_lambda_info_t *li = (jl_lambda_info_t*)e;
             if (jl_boot_file_loaded && li->ast && jl_is_expr(li->ast)) {
                 li->ast = jl_compress_ast(li, li->ast);
+                jl_gc_wb(li, li->ast);
             }
             return (jl_value_t*)jl_new_closure(NULL, (jl_value_t*)jl_null, li);
         }
@@ -273,6 +274,8 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         atypes = eval(args[1], locals, nl);
         meth = eval(args[2], locals, nl);
         jl_method_def(fname, bp, b, (jl_tuple_t*)atypes, (jl_function_t*)meth);
+        if (kw)
+            jl_gc_wb(((jl_function_t*)gf)->env, *bp);
         JL_GC_POP();
         return *bp;
     }
@@ -314,9 +317,11 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         temp = b->value;
         check_can_assign_type(b);
         b->value = (jl_value_t*)dt;
+        jl_gc_wb_binding(b, b->value);
         super = eval(args[2], locals, nl);
         jl_set_datatype_super(dt, super);
         b->value = temp;
+        jl_gc_wb_binding(b, b->value);
         if (temp==NULL || !equiv_type(dt, (jl_datatype_t*)temp)) {
             jl_checked_assignment(b, (jl_value_t*)dt);
         }
@@ -343,9 +348,11 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         temp = b->value;
         check_can_assign_type(b);
         b->value = (jl_value_t*)dt;
+        jl_gc_wb_binding(b, b->value);
         super = eval(args[3], locals, nl);
         jl_set_datatype_super(dt, super);
         b->value = temp;
+        jl_gc_wb_binding(b, b->value);
         if (temp==NULL || !equiv_type(dt, (jl_datatype_t*)temp)) {
             jl_checked_assignment(b, (jl_value_t*)dt);
         }
@@ -368,17 +375,20 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
                              0, args[6]==jl_true ? 1 : 0);
         dt->fptr = jl_f_ctor_trampoline;
         dt->ctor_factory = eval(args[3], locals, nl);
+        jl_gc_wb(dt, dt->ctor_factory);
 
         jl_binding_t *b = jl_get_binding_wr(jl_current_module, (jl_sym_t*)name);
         temp = b->value;  // save old value
         // temporarily assign so binding is available for field types
         check_can_assign_type(b);
         b->value = (jl_value_t*)dt;
+        jl_gc_wb_binding(b, b->value);
 
         JL_TRY {
             // operations that can fail
             inside_typedef = 1;
             dt->types = (jl_tuple_t*)eval(args[5], locals, nl);
+            jl_gc_wb(dt, dt->types);
             inside_typedef = 0;
             jl_check_type_tuple(dt->types, dt->name->name, "type definition");
             super = eval(args[4], locals, nl);
@@ -386,6 +396,7 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         }
         JL_CATCH {
             b->value = temp;
+            jl_gc_wb_binding(b, b->value);
             jl_rethrow();
         }
         for(size_t i=0; i < jl_tuple_len(para); i++) {
@@ -394,6 +405,7 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
         jl_compute_field_offsets(dt);
 
         b->value = temp;
+        jl_gc_wb_binding(b, b->value);
         if (temp==NULL || !equiv_type(dt, (jl_datatype_t*)temp)) {
             jl_checked_assignment(b, (jl_value_t*)dt);
 
@@ -415,6 +427,7 @@ static jl_value_t *eval(jl_value_t *e, jl_value_t **locals, size_t nl)
             f->linfo && f->linfo->ast && jl_is_expr(f->linfo->ast)) {
             jl_lambda_info_t *li = f->linfo;
             li->ast = jl_compress_ast(li, li->ast);
+            jl_gc_wb(li, li->ast);
             li->name = nm;
         }
         jl_set_global(jl_current_module, nm, (jl_value_t*)f);
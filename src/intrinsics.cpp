@@ -607,10 +607,7 @@ static Value *emit_pointerref(jl_value_t *e, jl_value_t *i, jl_codectx_t *ctx)
         }
         assert(jl_is_datatype(ety));
         uint64_t size = ((jl_datatype_t*)ety)->size;
-        Value *strct =
-            builder.CreateCall(jlallocobj_func,
-                               ConstantInt::get(T_size,
-                                    sizeof(void*)+size));
+        Value *strct = emit_allocobj(sizeof(void*)+size);
         builder.CreateStore(literal_pointer_val((jl_value_t*)ety),
                             emit_nthptr_addr(strct, (size_t)0));
         im1 = builder.CreateMul(im1, ConstantInt::get(T_size, size));
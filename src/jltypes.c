@@ -978,6 +978,90 @@ static jl_value_t *jl_type_intersect(jl_value_t *a, jl_value_t *b,
     return result;
 }
 
+/*
+  Memo of subtype and intersection results. This is a direct-mapped table
+  keyed on the identity of the two types, so only datatypes, which are
+  hash-consed by the type caches, are memoized. Tuple types are not: they
+  are mutable, and e.g. cache_method rewrites slots of a signature and
+  then compares it again. Both functions are pure, so an entry stays
+  valid as long as its types are alive. Entries are weak: the collector
+  clears those referring to unreachable objects before sweeping
+  (jl_sweep_type_memo), and changing the supertype of a type clears the
+  whole table.
+*/
+
+#define TYPEMEMO_SZ 4096
+
+// kinds of entries; subtype entries also record the
+// morespecific and invariant flags
+#define TYPEMEMO_SUBTYPE   1
+#define TYPEMEMO_INTERSECT 8
+
+typedef struct {
+    jl_value_t *a;
+    jl_value_t *b;
+    jl_value_t *result;
+    uptrint_t kind;
+} typememo_t;
+
+static typememo_t typememo[TYPEMEMO_SZ];
+
+// subtype hits, subtype misses, intersection hits, intersection misses
+static uint64_t typememo_stats[4];
+
+static typememo_t *typememo_slot(jl_value_t *a, jl_value_t *b, uptrint_t kind)
+{
+    uptrint_t h = inthash((uptrint_t)a*31 + (uptrint_t)b + kind);
+    return &typememo[h & (TYPEMEMO_SZ-1)];
+}
+
+static jl_value_t *typememo_get(jl_value_t *a, jl_value_t *b, uptrint_t kind)
+{
+    typememo_t *m = typememo_slot(a, b, kind);
+    int s = kind == TYPEMEMO_INTERSECT ? 2 : 0;
+    if (m->a == a && m->b == b && m->kind == kind) {
+        typememo_stats[s]++;
+        return m->result;
+    }
+    typememo_stats[s+1]++;
+    return NULL;
+}
+
+static void typememo_put(jl_value_t *a, jl_value_t *b, uptrint_t kind,
+                         jl_value_t *result)
+{
+    typememo_t *m = typememo_slot(a, b, kind);
+    m->a = a;
+    m->b = b;
+    m->result = result;
+    m->kind = kind;
+}
+
+void jl_type_memo_clear(void)
+{
+    memset(typememo, 0, sizeof(typememo));
+}
+
+void jl_sweep_type_memo(void)
+{
+    for(size_t i=0; i < TYPEMEMO_SZ; i++) {
+        typememo_t *m = &typememo[i];
+        if (m->a != NULL &&
+            !(jl_gc_marked(m->a) && jl_gc_marked(m->b) && jl_gc_marked(m->result)))
+            m->a = NULL;
+    }
+}
+
+DLLEXPORT void jl_type_memo_stats(uint64_t *out)
+{
+    memcpy(out, typememo_stats, sizeof(typememo_stats));
+}
+
+DLLEXPORT void jl_type_memo_stats_reset(void)
+{
+    memset(typememo_stats, 0, sizeof(typememo_stats));
+}
+
 jl_value_t *jl_type_intersection(jl_value_t *a, jl_value_t *b)
 {
     jl_tuple_t *env = jl_null;
@@ -1248,6 +1332,13 @@ void print_env(cenv_t *soln)
 jl_value_t *jl_type_intersection_matching(jl_value_t *a, jl_value_t *b,
                                           jl_tuple_t **penv, jl_tuple_t *tvars)
 {
+    // only results that do not involve an environment are memoized
+    int memo = (tvars == jl_null && jl_is_datatype(a) && jl_is_datatype(b));
+    if (memo) {
+        jl_value_t *ti = typememo_get(a, b, TYPEMEMO_INTERSECT);
+        if (ti != NULL)
+            return ti;
+    }
     jl_value_t **rts;
     JL_GC_PUSHARGS(rts, 1 + 2*MAX_CENV_SIZE);
     memset(rts, 0, (1+2*MAX_CENV_SIZE)*sizeof(void*));
@@ -1270,6 +1361,8 @@ jl_value_t *jl_type_intersection_matching(jl_value_t *a, jl_value_t *b,
     }
     if (*pti == (jl_value_t*)jl_bottom_type ||
         !(env.n > 0 || eqc.n > 0 || tvars != jl_null)) {
+        if (memo)
+            typememo_put(a, b, TYPEMEMO_INTERSECT, *pti);
         JL_GC_POP();
         return *pti;
     }
@@ -1584,10 +1677,106 @@ static int typekey_compare(jl_datatype_t *tt, jl_value_t **key, size_t n)
     return 1;
 }
 
+/*
+  Type caches. Each typename keeps the instantiations of its type in
+  tn->cache, an open-addressing hash table keyed on a structural hash of
+  the parameters that agrees with type_eqv_. Parameters that cannot be
+  hashed that way (unions, and values other than symbols and bits types)
+  put the type on tn->linearcache instead, which is scanned. Until
+  jl_array_any_type exists every type goes on the linear list; those are
+  moved into the table the first time the list becomes an Array.
+*/
+
+#define TYPECACHE_HASH_DEPTH 4
+
+#define typekey_mix(h,x) inthash((uint_t)(h)*31+(uint_t)(x))
+
+static uint_t typekey_hash_(jl_value_t *v, int depth, int *ok)
+{
+    if (jl_is_typector(v))
+        v = (jl_value_t*)((jl_typector_t*)v)->body;
+    if (jl_is_datatype(v)) {
+        jl_datatype_t *dt = (jl_datatype_t*)v;
+        uint_t h = dt->name->name->hash;
+        // deeper parameters are compared but not hashed
+        if (depth < TYPECACHE_HASH_DEPTH) {
+            size_t i, l = jl_tuple_len(dt->parameters);
+            for(i=0; i < l && *ok; i++)
+                h = typekey_mix(h, typekey_hash_(jl_tupleref(dt->parameters,i), depth+1, ok));
+        }
+        return h;
+    }
+    if (jl_is_tuple(v)) {
+        size_t i, l = jl_tuple_len(v);
+        uint_t h = typekey_mix(0x7475706c, l);
+        if (l > 0 && jl_is_vararg_type(jl_tupleref(v,l-1)))
+            h = typekey_mix(h, 1);
+        for(i=0; i < l && *ok; i++) {
+            jl_value_t *e = jl_tupleref(v,i);
+            if (jl_is_vararg_type(e)) e = jl_tparam0(e);
+            h = typekey_mix(h, typekey_hash_(e, depth+1, ok));
+        }
+        return h;
+    }
+    if (jl_is_typevar(v)) {
+        uint_t h = typekey_mix(0x74766172, typekey_hash_(((jl_tvar_t*)v)->ub, depth+1, ok));
+        return typekey_mix(h, typekey_hash_(((jl_tvar_t*)v)->lb, depth+1, ok));
+    }
+    if (jl_is_symbol(v))
+        return ((jl_sym_t*)v)->hash;
+    jl_value_t *t = (jl_value_t*)jl_typeof(v);
+    if (jl_is_bitstype(t)) {
+        uint_t h = typekey_hash_(t, depth+1, ok);
+        return typekey_mix(h, memhash((char*)jl_data_ptr(v), jl_datatype_size(t)));
+    }
+    // unions and other values can be equal without being structurally
+    // identical
+    *ok = 0;
+    return 0;
+}
+
+// returns 0 if the key cannot be hashed
+static int typekey_hash(jl_value_t **key, size_t n, uint_t *hv)
+{
+    int ok = 1;
+    uint_t h = n;
+    for(size_t j=0; j < n && ok; j++)
+        h = typekey_mix(h, typekey_hash_(key[j], 0, &ok));
+    *hv = h;
+    return ok;
+}
+
+static int typekey_match(jl_typename_t *tn, jl_datatype_t *tt, jl_value_t **key, size_t n)
+{
+    assert(jl_is_datatype(tt));
+    if (!typekey_compare(tt, key, n))
+        return 0;
+    if (tn == jl_type_type->name &&
+        (jl_is_typector(key[0]) != jl_is_typector(jl_tupleref(tt->parameters,0))))
+        return 0;
+    return 1;
+}
+
+#define typecache_max_probe(sz) ((sz)<=1024 ? 16 : (sz)>>6)
+
 static jl_value_t *lookup_type(jl_typename_t *tn, jl_value_t **key, size_t n)
 {
     if (n==0) return NULL;
-    jl_value_t *cache = tn->cache;
+    uint_t hv;
+    if (jl_is_array(tn->cache) && typekey_hash(key, n, &hv)) {
+        jl_array_t *a = (jl_array_t*)tn->cache;
+        size_t sz = jl_array_len(a);
+        size_t index = hv & (sz-1), iter = 0, maxprobe = typecache_max_probe(sz);
+        jl_value_t **tab = (jl_value_t**)jl_array_data(a);
+        while (tab[index] != NULL && iter <= maxprobe) {
+            if (typekey_match(tn, (jl_datatype_t*)tab[index], key, n))
+                return tab[index];
+            index = (index+1) & (sz-1);
+            iter++;
+        }
+        return NULL;
+    }
+    jl_value_t *cache = tn->linearcache;
     jl_value_t **data;
     size_t cl;
     if (jl_is_tuple(cache)) {
@@ -1595,22 +1784,58 @@ static jl_value_t *lookup_type(jl_typename_t *tn, jl_value_t **key, size_t n)
         cl = jl_tuple_len(cache);
     }
     else {
-        data = jl_array_data(cache);
+        data = (jl_value_t**)jl_array_data(cache);
         cl = jl_array_len(cache);
     }
     for(size_t i=0; i < cl; i++) {
         jl_datatype_t *tt = (jl_datatype_t*)data[i];
-        assert(jl_is_datatype(tt));
-        if (typekey_compare(tt, key, n)) {
-            if (tn == jl_type_type->name &&
-                (jl_is_typector(key[0]) != jl_is_typector(jl_tupleref(tt->parameters,0))))
-                continue;
+        if (typekey_match(tn, tt, key, n))
             return (jl_value_t*)tt;
-        }
     }
     return NULL;
 }
 
+static void typecache_insert(jl_typename_t *tn, jl_datatype_t *type, uint_t hv);
+
+static void typecache_rehash(jl_typename_t *tn, size_t newsz)
+{
+    jl_array_t *old = (jl_array_t*)tn->cache;
+    jl_array_t *a = jl_alloc_cell_1d(newsz);
+    tn->cache = (jl_value_t*)a;
+    jl_gc_wb(tn, a);
+    if (jl_is_array(old)) {
+        JL_GC_PUSH1(&old);
+        size_t i, sz = jl_array_len(old);
+        for(i=0; i < sz; i++) {
+            jl_datatype_t *tt = (jl_datatype_t*)jl_cellref(old, i);
+            if (tt != NULL) {
+                uint_t hv;
+                typekey_hash(tt->parameters->data, jl_tuple_len(tt->parameters), &hv);
+                typecache_insert(tn, tt, hv);
+            }
+        }
+        JL_GC_POP();
+    }
+}
+
+static void typecache_insert(jl_typename_t *tn, jl_datatype_t *type, uint_t hv)
+{
+    while (1) {
+        jl_array_t *a = (jl_array_t*)tn->cache;
+        size_t sz = jl_array_len(a);
+        size_t index = hv & (sz-1), iter = 0, maxprobe = typecache_max_probe(sz);
+        while (iter <= maxprobe) {
+            if (jl_cellref(a, index) == NULL) {
+                jl_cellset(a, index, (jl_value_t*)type);
+                return;
+            }
+            index = (index+1) & (sz-1);
+            iter++;
+        }
+        typecache_rehash(tn, sz<<2);
+    }
+}
+
 static int t_uid_ctr = 1;
 
 int  jl_get_t_uid_ctr(void) { return t_uid_ctr; }
@@ -1642,18 +1867,33 @@ static void cache_type_(jl_value_t *type)
     // assign uid
     if (!jl_is_abstracttype(type) && ((jl_datatype_t*)type)->uid==0)
         ((jl_datatype_t*)type)->uid = jl_assign_type_uid();
-    jl_value_t *cache = ((jl_datatype_t*)type)->name->cache;
+    jl_typename_t *tn = ((jl_datatype_t*)type)->name;
+    jl_value_t *cache = tn->linearcache;
     // this needs to work before jl_array_any_type exists, so start with
     // a tuple and switch to an Array when possible.
     if (jl_array_any_type != NULL) {
+        uint_t hv;
         if (jl_is_tuple(cache)) {
-            jl_array_t *nc = jl_alloc_cell_1d(jl_tuple_len(cache));
-            memcpy(nc->data, ((jl_tuple_t*)cache)->data, sizeof(void*)*jl_tuple_len(cache));
-            cache = (jl_value_t*)nc;
-            ((jl_datatype_t*)type)->name->cache = cache;
+            // move everything cached during bootstrap to where it belongs
+            JL_GC_PUSH1(&cache);
+            jl_array_t *nc = jl_alloc_cell_1d(0);
+            tn->linearcache = (jl_value_t*)nc;
+            jl_gc_wb(tn, nc);
+            if (!jl_is_array(tn->cache))
+                typecache_rehash(tn, 16);
+            for(size_t i=0; i < jl_tuple_len(cache); i++) {
+                jl_datatype_t *tt = (jl_datatype_t*)jl_tupleref(cache,i);
+                if (typekey_hash(tt->parameters->data, jl_tuple_len(tt->parameters), &hv))
+                    typecache_insert(tn, tt, hv);
+                else
+                    jl_cell_1d_push(nc, (jl_value_t*)tt);
+            }
+            JL_GC_POP();
         }
-        assert(jl_is_array(cache));
-        jl_cell_1d_push((jl_array_t*)cache, (jl_value_t*)type);
+        if (typekey_hash(t->data, jl_tuple_len(t), &hv))
+            typecache_insert(tn, (jl_datatype_t*)type, hv);
+        else
+            jl_cell_1d_push((jl_array_t*)tn->linearcache, type);
     }
     else {
         assert(jl_is_tuple(cache));
@@ -1661,7 +1901,8 @@ static void cache_type_(jl_value_t *type)
         jl_tuple_t *nc = jl_alloc_tuple_uninit(n+1);
         memcpy(nc->data, ((jl_tuple_t*)cache)->data, sizeof(void*) * n);
         jl_tupleset(nc, n, (jl_value_t*)type);
-        ((jl_datatype_t*)type)->name->cache = (jl_value_t*)nc;
+        tn->linearcache = (jl_value_t*)nc;
+        jl_gc_wb(tn, nc);
     }
 }
 
@@ -1836,10 +2077,12 @@ static jl_value_t *inst_type_w_(jl_value_t *t, jl_value_t **env, size_t n,
         ndt->struct_decl = NULL;
         ndt->size = ndt->alignment = 0;
         ndt->super = (jl_datatype_t*)inst_type_w_((jl_value_t*)dt->super, env,n,stack);
+        jl_gc_wb(ndt, ndt->super);
         jl_tuple_t *ftypes = dt->types;
         if (ftypes != NULL) {
             // recursively instantiate the types of the fields
             ndt->types = (jl_tuple_t*)inst_type_w_((jl_value_t*)ftypes, env, n, stack);
+            jl_gc_wb(ndt, ndt->types);
             if (!isabstract) {
                 jl_compute_field_offsets(ndt);
             }
@@ -1891,9 +2134,11 @@ void jl_reinstantiate_inner_types(jl_datatype_t *t)
         env[i*2+1] = env[i*2];
     }
     t->super = (jl_datatype_t*)inst_type_w_((jl_value_t*)t->super, env, n, &top);
+    jl_gc_wb(t, t->super);
     if (jl_is_datatype(t)) {
         jl_datatype_t *st = (jl_datatype_t*)t;
         st->types = (jl_tuple_t*)inst_type_w_((jl_value_t*)st->types, env, n, &top);
+        jl_gc_wb(st, st->types);
     }
 }
 
@@ -1986,6 +2231,63 @@ static int partially_morespecific(jl_value_t *a, jl_value_t *b, int invariant)
     return jl_subtype_le(a, b, 0, 1, invariant);
 }
 
+// jl_subtype_le for two datatypes: find a's supertype with b's name
+// and compare parameters
+static int jl_subtype_le_datatype(jl_datatype_t *tta, jl_datatype_t *ttb,
+                                   int morespecific, int invariant)
+{
+    jl_value_t *a = (jl_value_t*)tta, *b = (jl_value_t*)ttb;
+    size_t i;
+    int super=0;
+    while (tta != (jl_datatype_t*)jl_any_type) {
+        if (tta->name == ttb->name) {
+            if (super && morespecific) {
+                if (tta->name != jl_type_type->name)
+                    return 1;
+            }
+            if (tta->name == jl_ntuple_typename) {
+                // NTuple must be covariant
+                return jl_subtype_le(jl_tupleref(tta->parameters,1),
+                                     jl_tupleref(ttb->parameters,1),
+                                     0, morespecific, invariant);
+            }
+            if (super && ttb->name == jl_type_type->name && jl_is_typevar(jl_tparam0(b))) {
+                if (jl_subtype_le(a, jl_tparam0(b), 0, morespecific, 1))
+                    return 1;
+            }
+            assert(jl_tuple_len(tta->parameters) == jl_tuple_len(ttb->parameters));
+            for(i=0; i < jl_tuple_len(tta->parameters); i++) {
+                jl_value_t *apara = jl_tupleref(tta->parameters,i);
+                jl_value_t *bpara = jl_tupleref(ttb->parameters,i);
+                if (invariant && !morespecific && jl_is_typevar(bpara) &&
+                    !((jl_tvar_t*)bpara)->bound) {
+                    if (!jl_is_typevar(apara))
+                        return 0;
+                }
+                if (!jl_subtype_le(apara, bpara, 0, morespecific, 1))
+                    return 0;
+            }
+            return 1;
+        }
+        else if (invariant) {
+            return 0;
+        }
+        tta = tta->super; super = 1;
+    }
+    assert(!invariant);
+    /*
+    if (((jl_datatype_t*)a)->name == jl_type_type->name) {
+        // Type{T} also matches >:typeof(T)
+        jl_value_t *tp0a = jl_tparam0(a);
+        if (!jl_is_typevar(tp0a))
+            return jl_subtype_le(tp0a, b, 1, morespecific, 0);
+        if (jl_subtype_le((jl_value_t*)jl_uniontype_type, b, 0, 0, 0))
+            return jl_subtype_le(((jl_tvar_t*)tp0a)->ub, b, 1, morespecific, 0);
+    }
+    */
+    return 0;
+}
+
 /*
   ta specifies whether typeof() should be implicitly applied to a.
   this is used for tuple types to avoid allocating them explicitly.
@@ -2109,54 +2411,17 @@ static int jl_subtype_le(jl_value_t *a, jl_value_t *b, int ta, int morespecific,
         if ((jl_datatype_t*)a == jl_any_type) return 0;
         jl_datatype_t *tta = (jl_datatype_t*)a;
         jl_datatype_t *ttb = (jl_datatype_t*)b;
-        int super=0;
-        while (tta != (jl_datatype_t*)jl_any_type) {
-            if (tta->name == ttb->name) {
-                if (super && morespecific) {
-                    if (tta->name != jl_type_type->name)
-                        return 1;
-                }
-                if (tta->name == jl_ntuple_typename) {
-                    // NTuple must be covariant
-                    return jl_subtype_le(jl_tupleref(tta->parameters,1),
-                                         jl_tupleref(ttb->parameters,1),
-                                         0, morespecific, invariant);
-                }
-                if (super && ttb->name == jl_type_type->name && jl_is_typevar(jl_tparam0(b))) {
-                    if (jl_subtype_le(a, jl_tparam0(b), 0, morespecific, 1))
-                        return 1;
-                }
-                assert(jl_tuple_len(tta->parameters) == jl_tuple_len(ttb->parameters));
-                for(i=0; i < jl_tuple_len(tta->parameters); i++) {
-                    jl_value_t *apara = jl_tupleref(tta->parameters,i);
-                    jl_value_t *bpara = jl_tupleref(ttb->parameters,i);
-                    if (invariant && !morespecific && jl_is_typevar(bpara) &&
-                        !((jl_tvar_t*)bpara)->bound) {
-                        if (!jl_is_typevar(apara))
-                            return 0;
-                    }
-                    if (!jl_subtype_le(apara, bpara, 0, morespecific, 1))
-                        return 0;
-                }
-                return 1;
-            }
-            else if (invariant) {
-                return 0;
-            }
-            tta = tta->super; super = 1;
+        // comparing parameters is what makes this expensive
+        if (jl_tuple_len(tta->parameters) > 0 || jl_tuple_len(ttb->parameters) > 0) {
+            uptrint_t kind = TYPEMEMO_SUBTYPE | (morespecific<<1) | (invariant<<2);
+            jl_value_t *r = typememo_get(a, b, kind);
+            if (r != NULL)
+                return r == jl_true;
+            int sub = jl_subtype_le_datatype(tta, ttb, morespecific, invariant);
+            typememo_put(a, b, kind, sub ? jl_true : jl_false);
+            return sub;
         }
-        assert(!invariant);
-        /*
-        if (((jl_datatype_t*)a)->name == jl_type_type->name) {
-            // Type{T} also matches >:typeof(T)
-            jl_value_t *tp0a = jl_tparam0(a);
-            if (!jl_is_typevar(tp0a))
-                return jl_subtype_le(tp0a, b, 1, morespecific, 0);
-            if (jl_subtype_le((jl_value_t*)jl_uniontype_type, b, 0, 0, 0))
-                return jl_subtype_le(((jl_tvar_t*)tp0a)->ub, b, 1, morespecific, 0);
-        }
-        */
-        return 0;
+        return jl_subtype_le_datatype(tta, ttb, morespecific, invariant);
     }
 
     if (jl_is_typevar(a)) {
@@ -2513,7 +2778,7 @@ void jl_init_types(void)
     // create base objects
     jl_datatype_type = jl_new_uninitialized_datatype(14);
     jl_datatype_type->type = (jl_value_t*)jl_datatype_type;
-    jl_typename_type = jl_new_uninitialized_datatype(4);
+    jl_typename_type = jl_new_uninitialized_datatype(5);
     jl_sym_type = jl_new_uninitialized_datatype(0);
     jl_symbol_type = jl_sym_type;
 
@@ -2573,11 +2838,12 @@ void jl_init_types(void)
     jl_typename_type->name->primary = (jl_value_t*)jl_typename_type;
     jl_typename_type->super = jl_any_type;
     jl_typename_type->parameters = jl_null;
-    jl_typename_type->names = jl_tuple(4, jl_symbol("name"),
+    jl_typename_type->names = jl_tuple(5, jl_symbol("name"),
                                        jl_symbol("module"),
-                                       jl_symbol("primary"), jl_symbol(""));
-    jl_typename_type->types = jl_tuple(4, jl_sym_type, jl_any_type,
-                                       jl_type_type, jl_any_type);
+                                       jl_symbol("primary"), jl_symbol(""),
+                                       jl_symbol(""));
+    jl_typename_type->types = jl_tuple(5, jl_sym_type, jl_any_type,
+                                       jl_type_type, jl_any_type, jl_any_type);
     jl_typename_type->uid = jl_assign_type_uid();
     jl_typename_type->fptr = jl_f_no_function;
     jl_typename_type->env = (jl_value_t*)jl_null;
@@ -2672,23 +2938,27 @@ void jl_init_types(void)
 
     jl_method_type =
         jl_new_datatype(jl_symbol("Method"), jl_any_type, jl_null,
-                        jl_tuple(6, jl_symbol("sig"), jl_symbol("va"),
+                        jl_tuple(7, jl_symbol("sig"), jl_symbol("va"),
                                  jl_symbol("tvars"), jl_symbol("func"),
-                                 jl_symbol("invokes"), jl_symbol("next")),
-                        jl_tuple(6, jl_tuple_type, jl_bool_type,
+                                 jl_symbol("invokes"), jl_symbol("next"),
+                                 jl_symbol("rank")),
+                        jl_tuple(7, jl_tuple_type, jl_bool_type,
                                  jl_tuple_type, jl_any_type,
-                                 jl_any_type, jl_any_type),
+                                 jl_any_type, jl_any_type, jl_long_type),
                         0, 1);
     jl_method_type->fptr = jl_f_no_function;
 
     jl_methtable_type =
         jl_new_datatype(jl_symbol("MethodTable"), jl_any_type, jl_null,
-                        jl_tuple(7, jl_symbol("name"), jl_symbol("defs"),
+                        jl_tuple(10, jl_symbol("name"), jl_symbol("defs"),
                                  jl_symbol("cache"), jl_symbol("cache_arg1"),
-                                 jl_symbol("cache_targ"),
-                                 jl_symbol("max_args"), jl_symbol("kwsorter")),
-                        jl_tuple(7, jl_sym_type, jl_any_type, jl_any_type,
-                                 jl_any_type, jl_any_type, jl_long_type,
+                                 jl_symbol("cache_targ"), jl_symbol("cache_leaf"),
+                                 jl_symbol("max_args"), jl_symbol("kwsorter"),
+                                 jl_symbol("max_specializations"),
+                                 jl_symbol("defs_index")),
+                        jl_tuple(10, jl_sym_type, jl_any_type, jl_any_type,
+                                 jl_any_type, jl_any_type, jl_any_type,
+                                 jl_long_type, jl_any_type, jl_long_type,
                                  jl_any_type),
                         0, 1);
     jl_methtable_type->fptr = jl_f_no_function;
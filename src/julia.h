@@ -74,8 +74,8 @@ typedef struct _jl_value_t {
 
 typedef struct _jl_sym_t {
     JL_DATA_TYPE
-    struct _jl_sym_t *left;
-    struct _jl_sym_t *right;
+    struct _jl_sym_t *next;  // next symbol in the same symtab bucket
+    size_t len;        // length of name
     uptrint_t hash;    // precomputed hash value
     JL_ATTRIBUTE_ALIGN_PTRSIZE(char name[]);
 } jl_sym_t;
@@ -180,11 +180,20 @@ typedef struct _jl_lambda_info_t {
     // used to avoid infinite recursion
     int8_t inInference : 1;
     int8_t inCompile : 1;
+    // compiled with only a few cheap passes; see jl_tier_threshold
+    int8_t quickCompiled : 1;
+    int8_t tierQueued : 1;  // waiting in jl_tier_queue
+    int8_t noVectorize : 1; // opted out of loop and SLP vectorization
     jl_fptr_t fptr;        // jlcall entry point
     void *functionObject;  // jlcall llvm Function
     void *cFunctionObject; // c callable llvm Function
     int32_t functionID; // index that this function will have in the codegen table
     int32_t cFunctionID; // index that this cFunction will have in the codegen table
+    // under tiered compilation, the entry point of the quick-compiled code
+    // (fptr is then jl_tier_trampoline), and the number of calls and loop
+    // iterations it has run
+    jl_fptr_t quickFptr;
+    int32_t tierCount;
 } jl_lambda_info_t;
 
 #define LAMBDA_INFO_NW (NWORDS(sizeof(jl_lambda_info_t))-1)
@@ -214,7 +223,8 @@ typedef struct {
     // a type alias, for example, might make a type constructor that is
     // not the original.
     jl_value_t *primary;
-    jl_value_t *cache;
+    jl_value_t *cache;        // hash table of instantiations
+    jl_value_t *linearcache;  // instantiations whose parameters can't be hashed
 } jl_typename_t;
 
 typedef struct {
@@ -244,7 +254,9 @@ typedef struct _jl_datatype_t {
     uint8_t mutabl;
     uint8_t pointerfree;
     // hidden fields:
-    uint32_t alignment;  // strictest alignment over all fields
+    uint32_t alignment : 31;  // strictest alignment over all fields
+    uint32_t haspadding : 1;  // gaps between or after fields, so a
+                              // pointerfree value can't be compared as bytes
     uint32_t uid;
     void *struct_decl;  //llvm::Value*
     jl_fielddesc_t fields[];
@@ -305,10 +317,9 @@ typedef struct _jl_methlist_t {
     // TODO: pointer from specialized to original method
     //jl_function_t *orig_method;
     struct _jl_methlist_t *next;
+    ptrint_t rank;  // increases along a method table's defs; see gf.c
 } jl_methlist_t;
 
-//#define JL_GF_PROFILE
-
 typedef struct _jl_methtable_t {
     JL_DATA_TYPE
     jl_sym_t *name;
@@ -316,11 +327,11 @@ typedef struct _jl_methtable_t {
     jl_methlist_t *cache;
     jl_array_t *cache_arg1;
     jl_array_t *cache_targ;
+    jl_array_t *cache_leaf;  // hashed on all argument types; see gf.c
     ptrint_t max_args;  // max # of non-vararg arguments in a signature
     jl_function_t *kwsorter;  // keyword argument sorter function
-#ifdef JL_GF_PROFILE
-    int ncalls;
-#endif
+    ptrint_t max_specializations;  // per method; 0 for jl_max_specializations
+    jl_array_t *defs_index;  // defs by first argument type; see gf.c
 } jl_methtable_t;
 
 typedef struct {
@@ -483,23 +494,86 @@ extern jl_sym_t *boundscheck_sym; extern jl_sym_t *copyast_sym;
 #ifdef JL_GC_MARKSWEEP
 void *allocb(size_t sz);
 void *allocobj(size_t sz);
+
+// bump-pointer allocation state of a pool. generated code allocates small
+// objects inline by advancing cur while it stays within end.
+typedef struct {
+    char *cur;
+    char *end;
+} jl_gc_bump_t;
+extern DLLEXPORT jl_gc_bump_t jl_gc_bump[];
+DLLEXPORT int jl_gc_pool_index(size_t sz, size_t *osize);
+
+// gc bits, kept in the low bits of an object's type tag (or of the header
+// word of a buffer from allocb). jl_typeof masks them off.
+#define GC_MARKED 1  // reached in the current collection (only used for
+                     // objects outside of pool pages, which are marked in a
+                     // bitmap); on an old object outside of a collection: it
+                     // is in the remembered set
+#define GC_OLD    2  // promoted to the old generation
+#define GC_BITS_MASK ((uptrint_t)3)
+#define jl_gc_bits(v)     (((uptrint_t)((jl_value_t*)(v))->type)&GC_BITS_MASK)
+#define jl_gc_buf_bits(b) ((((uptrint_t*)(b))[-1])&GC_BITS_MASK)
+
+DLLEXPORT void jl_gc_queue_root(jl_value_t *root);
+DLLEXPORT void jl_gc_queue_binding(void *bnd);
+
+// write barriers. when a reference to `ptr` is stored into `parent`, and
+// parent might have been promoted (i.e. a collection may have happened
+// since it was allocated), the store must be followed by one of these.
+STATIC_INLINE void jl_gc_wb(void *parent, void *ptr)
+{
+    if (__unlikely(jl_gc_bits(parent) == GC_OLD && ptr != NULL &&
+                   !(jl_gc_bits(ptr) & GC_OLD)))
+        jl_gc_queue_root((jl_value_t*)parent);
+}
+
+// for stores that are hard to describe one pointer at a time, e.g. a new
+// data buffer for an array, or a task's stack.
+STATIC_INLINE void jl_gc_wb_back(void *parent)
+{
+    if (__unlikely(jl_gc_bits(parent) == GC_OLD))
+        jl_gc_queue_root((jl_value_t*)parent);
+}
+
+// bindings are buffers, so their gc bits live in the header word
+STATIC_INLINE void jl_gc_wb_binding(void *bnd, void *ptr)
+{
+    if (__unlikely(jl_gc_buf_bits(bnd) == GC_OLD && ptr != NULL &&
+                   !(jl_gc_bits(ptr) & GC_OLD)))
+        jl_gc_queue_binding(bnd);
+}
 #else
 #define allocb(nb)    malloc(nb)
 #define allocobj(nb)  malloc(nb)
+#define jl_gc_wb(parent, ptr)
+#define jl_gc_wb_back(parent)
+#define jl_gc_wb_binding(bnd, ptr)
 #endif
 
 #ifdef OVERLAP_TUPLE_LEN
 #define jl_tupleref(t,i) (((jl_value_t**)(t))[1+(i)])
-#define jl_tupleset(t,i,x) ((((jl_value_t**)(t))[1+(i)])=(jl_value_t*)(x))
 #else
 #define jl_tupleref(t,i) (((jl_value_t**)(t))[2+(i)])
-#define jl_tupleset(t,i,x) ((((jl_value_t**)(t))[2+(i)])=(jl_value_t*)(x))
 #endif
 #define jl_t0(t) jl_tupleref(t,0)
 #define jl_t1(t) jl_tupleref(t,1)
 
+STATIC_INLINE jl_value_t *jl_tupleset(void *t, size_t i, void *x)
+{
+    jl_tupleref(t,i) = (jl_value_t*)x;
+    jl_gc_wb(t, x);
+    return (jl_value_t*)x;
+}
+
 #define jl_cellref(a,i) (((jl_value_t**)((jl_array_t*)a)->data)[(i)])
-#define jl_cellset(a,i,x) ((((jl_value_t**)((jl_array_t*)a)->data)[(i)])=((jl_value_t*)(x)))
+
+STATIC_INLINE jl_value_t *jl_cellset(void *a, size_t i, void *x)
+{
+    jl_cellref(a,i) = (jl_value_t*)x;
+    jl_gc_wb(a, x);
+    return (jl_value_t*)x;
+}
 
 #define jl_exprarg(e,n) jl_cellref(((jl_expr_t*)(e))->args,n)
 
@@ -518,9 +592,9 @@ void *allocobj(size_t sz);
 #define jl_tparam1(t) jl_tupleref(((jl_datatype_t*)(t))->parameters, 1)
 
 #ifdef OVERLAP_TUPLE_LEN
-#define jl_typeof(v) ((jl_value_t*)((uptrint_t)((jl_value_t*)(v))->type & 0x000ffffffffffffeULL))
+#define jl_typeof(v) ((jl_value_t*)((uptrint_t)((jl_value_t*)(v))->type & 0x000ffffffffffffcULL))
 #else
-#define jl_typeof(v) (((jl_value_t*)(v))->type)
+#define jl_typeof(v) ((jl_value_t*)((uptrint_t)((jl_value_t*)(v))->type & ~(uptrint_t)3))
 #endif
 #define jl_typeis(v,t) (jl_typeof(v)==(jl_value_t*)(t))
 
@@ -722,7 +796,7 @@ DLLEXPORT jl_sym_t *jl_symbol_lookup(const char *str);
 DLLEXPORT jl_sym_t *jl_symbol_n(const char *str, int32_t len);
 DLLEXPORT jl_sym_t *jl_gensym(void);
 DLLEXPORT jl_sym_t *jl_tagged_gensym(const char *str, int32_t len);
-DLLEXPORT jl_sym_t *jl_get_root_symbol(void);
+DLLEXPORT void jl_foreach_symbol(void (*f)(jl_sym_t*, void*), void *ctx);
 jl_expr_t *jl_exprn(jl_sym_t *head, size_t n);
 jl_function_t *jl_new_generic_function(jl_sym_t *name);
 void jl_initialize_generic_function(jl_function_t *f, jl_sym_t *name);
@@ -996,7 +1070,34 @@ jl_function_t *jl_method_lookup_by_type(jl_methtable_t *mt, jl_tuple_t *types,
 jl_function_t *jl_method_lookup(jl_methtable_t *mt, jl_value_t **args, size_t nargs, int cache);
 jl_value_t *jl_gf_invoke(jl_function_t *gf, jl_tuple_t *types,
                          jl_value_t **args, size_t nargs);
+extern DLLEXPORT size_t jl_max_specializations;
+// call-site inline caches for generic functions; see gf.c
+#define JL_IC_ENTRIES  4
+#define JL_IC_MAX_ARGS 4
+extern DLLEXPORT size_t jl_ic_epoch;
+DLLEXPORT jl_value_t *jl_apply_generic_ic(jl_function_t *F, jl_value_t **args,
+                                          uint32_t nargs, jl_value_t **ic);
 void jl_fptr_to_llvm(void *fptr, jl_lambda_info_t *lam, int specsig);
+// tiered compilation: when nonzero, functions are first compiled with few
+// optimizations and recompiled fully after this many calls or loop iterations
+extern DLLEXPORT int jl_tier_threshold;
+DLLEXPORT void jl_set_tiered_compilation(int threshold);
+DLLEXPORT int jl_is_quick_compiled(jl_lambda_info_t *li);
+DLLEXPORT int32_t jl_tier_count(jl_lambda_info_t *li);
+DLLEXPORT void jl_set_async_compilation(int on);
+DLLEXPORT int jl_tier_run_queue(int n);
+void jl_tier_up(jl_lambda_info_t *li);
+// loop and SLP vectorization of compiled code, off by default
+DLLEXPORT void jl_set_vectorize_default(int on);
+DLLEXPORT void jl_set_vectorize(jl_lambda_info_t *li, int on);
+
+// processor features, as reported by jl_cpu_features
+#define JL_CPU_X86    0x01  // cpuid is available; the rest are meaningful
+#define JL_CPU_SSE2   0x02
+#define JL_CPU_SSE41  0x04
+#define JL_CPU_AVX    0x08  // supported by both the processor and the OS
+#define JL_CPU_AVX2   0x10
+DLLEXPORT uint32_t jl_cpu_features(void);
 
 // AST access
 jl_array_t *jl_lam_args(jl_expr_t *l);
@@ -1115,12 +1216,45 @@ extern DLLEXPORT jl_gcframe_t *jl_pgcstack;
 void jl_print_gc_stats(JL_STREAM *s);
 #endif
 
+// a record of one collection, as returned by jl_gc_get_stats.
+// the layout is mirrored by GCEvent in base/util.jl.
+typedef struct {
+    double start;          // clock_now() when the collection began
+    double mark_time;      // seconds
+    double sweep_time;
+    double finalize_time;
+    int64_t allocd;        // bytes allocated since the previous collection
+    int64_t freed;         // bytes freed
+    int64_t live;          // bytes marked (a quick one skips most old objects)
+    int64_t pages;         // pool pages in use after the sweep
+    int64_t pages_cached;  // free pool pages still held
+    int32_t nfinal;        // finalizers run right after it
+    int32_t full;          // 0 for a quick (young only) collection
+} jl_gc_event_t;
+
 void jl_gc_init(void);
 void jl_gc_setmark(jl_value_t *v);
+int jl_gc_marked(jl_value_t *v);
 DLLEXPORT void jl_gc_enable(void);
 DLLEXPORT void jl_gc_disable(void);
 DLLEXPORT int jl_gc_is_enabled(void);
+DLLEXPORT void jl_gc_set_heap_limit(size_t bytes);
+DLLEXPORT size_t jl_gc_heap_limit(void);
+DLLEXPORT void jl_gc_set_pause_target(double sec);
+DLLEXPORT double jl_gc_pause_target(void);
+DLLEXPORT void jl_gc_set_throughput(double t);
+DLLEXPORT double jl_gc_throughput(void);
+DLLEXPORT void jl_gc_set_generational(int on);
+DLLEXPORT int jl_gc_is_generational(void);
+DLLEXPORT void jl_gc_set_lazy_sweep(int on);
+DLLEXPORT int jl_gc_is_lazy_sweep(void);
+DLLEXPORT void jl_gc_set_page_idle_time(double sec);
+DLLEXPORT void jl_gc_set_mark_threads(int n);
+DLLEXPORT int jl_gc_mark_threads(void);
 DLLEXPORT int64_t jl_gc_total_bytes(void);
+DLLEXPORT size_t jl_gc_get_stats(jl_gc_event_t *out, size_t n);
+DLLEXPORT uint64_t jl_gc_num_collections(void);
+DLLEXPORT int jl_gc_set_log_file(const char *path);
 void jl_gc_ephemeral_on(void);
 void jl_gc_ephemeral_off(void);
 DLLEXPORT void jl_gc_collect(void);
@@ -1128,6 +1262,12 @@ void jl_gc_preserve(jl_value_t *v);
 void jl_gc_unpreserve(void);
 int jl_gc_n_preserved_values(void);
 DLLEXPORT void jl_gc_add_finalizer(jl_value_t *v, jl_function_t *f);
+DLLEXPORT size_t jl_gc_run_finalizers(void);
+DLLEXPORT void jl_gc_set_finalizer_batch(size_t n);
+DLLEXPORT size_t jl_gc_finalizer_batch(void);
+DLLEXPORT size_t jl_gc_finalizer_queue_len(void);
+DLLEXPORT size_t jl_gc_finalizer_queue_max(void);
+DLLEXPORT uint64_t jl_gc_num_finalized(void);
 DLLEXPORT jl_weakref_t *jl_gc_new_weakref(jl_value_t *value);
 void *jl_gc_managed_malloc(size_t sz);
 void *jl_gc_managed_realloc(void *d, size_t sz, size_t oldsz, int isaligned);
@@ -82,6 +82,7 @@ jl_binding_t *jl_get_binding_wr(jl_module_t *m, jl_sym_t *var)
     b = new_binding(var);
     b->owner = m;
     *bp = b;
+    jl_gc_wb_back(m);
     return *bp;
 }
 
@@ -109,6 +110,7 @@ jl_binding_t *jl_get_binding_for_method_def(jl_module_t *m, jl_sym_t *var)
     b = new_binding(var);
     b->owner = m;
     *bp = b;
+    jl_gc_wb_back(m);
     return *bp;
 }
 
@@ -224,6 +226,7 @@ static void module_import_(jl_module_t *to, jl_module_t *from, jl_sym_t *s,
             nb->owner = b->owner;
             nb->imported = (explici!=0);
             *bp = nb;
+            jl_gc_wb_back(to);
         }
     }
 }
@@ -282,6 +285,7 @@ void jl_module_using(jl_module_t *to, jl_module_t *from)
     }
 
     arraylist_push(&to->usings, from);
+    jl_gc_wb(to, from);
 }
 
 void jl_module_export(jl_module_t *from, jl_sym_t *s)
@@ -292,6 +296,7 @@ void jl_module_export(jl_module_t *from, jl_sym_t *s)
         // don't yet know who the owner is
         b->owner = NULL;
         *bp = b;
+        jl_gc_wb_back(from);
     }
     assert(*bp != HT_NOTFOUND);
     (*bp)->exportp = 1;
@@ -329,6 +334,7 @@ void jl_set_global(jl_module_t *m, jl_sym_t *var, jl_value_t *val)
     jl_binding_t *bp = jl_get_binding_wr(m, var);
     if (!bp->constp) {
         bp->value = val;
+        jl_gc_wb_binding(bp, val);
     }
 }
 
@@ -338,6 +344,7 @@ void jl_set_const(jl_module_t *m, jl_sym_t *var, jl_value_t *val)
     if (!bp->constp) {
         bp->value = val;
         bp->constp = 1;
+        jl_gc_wb_binding(bp, val);
     }
 }
 
@@ -360,6 +367,7 @@ DLLEXPORT void jl_checked_assignment(jl_binding_t *b, jl_value_t *rhs)
         }
     }
     b->value = rhs;
+    jl_gc_wb_binding(b, rhs);
 }
 
 DLLEXPORT void jl_declare_constant(jl_binding_t *b)
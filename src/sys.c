@@ -427,7 +427,8 @@ void cpuid(int32_t CPUInfo[4], int32_t InfoType)
         "=a" (CPUInfo[0]),
         "=c" (CPUInfo[2]),
         "=d" (CPUInfo[3]) :
-        "a" (InfoType)
+        "a" (InfoType),
+        "c" (0)  // subleaf, for leaves that have them
     );
 }
 
@@ -463,6 +464,48 @@ DLLEXPORT uint8_t jl_zero_subnormals(uint8_t isZero)
     return 0;
 }
 
+// read an extended control register; only valid when OSXSAVE is set
+static uint64_t xgetbv(uint32_t xcr)
+{
+#if defined(_OS_WINDOWS_) && defined(_MSC_VER)
+    return _xgetbv(xcr);
+#else
+    uint32_t lo, hi;
+    // the xgetbv opcode, for assemblers that do not know it
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (lo), "=d" (hi) : "c" (xcr));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+DLLEXPORT uint32_t jl_cpu_features(void)
+{
+    uint32_t features = JL_CPU_X86;
+    int32_t info[4];
+
+    cpuid(info, 0);
+    int32_t maxleaf = info[0];
+    if (maxleaf < 1)
+        return features;
+    cpuid(info, 0x00000001);
+    if (info[3] & ((int)1 << 26))
+        features |= JL_CPU_SSE2;
+    if (info[2] & ((int)1 << 19))
+        features |= JL_CPU_SSE41;
+    // AVX also needs the OS to save the YMM registers on context switches.
+    // it implies the SSE4 instructions, which a virtualized cpuid may hide
+    if ((features & JL_CPU_SSE41) &&
+        (info[2] & ((int)1 << 28)) && (info[2] & ((int)1 << 27)) &&
+        (xgetbv(0) & 0x6) == 0x6) {
+        features |= JL_CPU_AVX;
+        if (maxleaf >= 7) {
+            cpuid(info, 0x00000007);
+            if (info[1] & ((int)1 << 5))
+                features |= JL_CPU_AVX2;
+        }
+    }
+    return features;
+}
+
 #else
 
 DLLEXPORT uint8_t jl_zero_subnormals(uint8_t isZero)
@@ -470,6 +513,11 @@ DLLEXPORT uint8_t jl_zero_subnormals(uint8_t isZero)
     return 0;
 }
 
+DLLEXPORT uint32_t jl_cpu_features(void)
+{
+    return 0;
+}
+
 #endif
 
 // -- processor native alignment information --
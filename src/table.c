@@ -1,113 +1,217 @@
+// identity hash tables (ObjectIdDict)
+//
+// a table is a cell array of key/value pairs followed by one extra slot that
+// holds its metadata: a byte array with the number of used slots, the number
+// of deleted entries, and the cached jl_object_id of the key in each slot.
+// probes compare the cached hashes before calling jl_egal.
+//
+// insertion is robin-hood: a new entry takes the place of any entry that is
+// closer to its home slot, and the displaced entry moves on. this bounds the
+// variance of probe lengths and lets lookups stop early.
+//
+// deleting only clears the value, leaving a tombstone, so that iteration and
+// probe sequences are not disturbed. tombstones can be reused by insertion
+// and are dropped when the table is rehashed. a table that needs room but is
+// mostly tombstones is rehashed at the same size instead of growing.
+//
+// a table without metadata (e.g. a fresh `cell(32)`) is always empty, and
+// gets its metadata on the first insertion.
+
 #define hash_size(h) (jl_array_len(h)/2)
 
 // compute empirical max-probe for a given size
 #define max_probe(size) ((size)<=1024 ? 16 : (size)>>6)
 
 #define keyhash(k)     jl_object_id(k)
-#define h2index(hv,sz) (index_t)(((hv) & ((sz)-1))*2)
+#define h2slot(hv,sz)  (size_t)((hv) & ((sz)-1))
+#define probe_dist(hv,i,sz) (((i) - h2slot(hv,sz)) & ((sz)-1))
+
+#define meta_used(m)    ((m)[0])
+#define meta_deleted(m) ((m)[1])
+#define meta_hash(m,i)  ((m)[2+(i)])
+
+static uptrint_t *eqtable_meta(jl_array_t *a)
+{
+    size_t len = jl_array_len(a);
+    if (!(len & 1))
+        return NULL;
+    jl_array_t *m = (jl_array_t*)jl_cellref(a, len-1);
+    if (m == NULL)
+        return NULL;
+    return (uptrint_t*)m->data;
+}
 
-static void **jl_table_lookup_bp(jl_array_t **pa, void *key);
+static jl_array_t *eqtable_alloc(size_t sz)
+{
+    jl_array_t *a = jl_alloc_cell_1d(2*sz+1);
+    JL_GC_PUSH1(&a);
+    size_t nb = (sz+2)*sizeof(uptrint_t);
+    jl_array_t *m = jl_alloc_array_1d(jl_array_uint8_type, nb);
+    memset(m->data, 0, nb);
+    jl_cellset(a, 2*sz, m);
+    JL_GC_POP();
+    return a;
+}
+
+// room for one more key without exceeding a 3/4 load factor
+static int eqtable_has_room(uptrint_t *m, size_t sz)
+{
+    return meta_used(m) + 1 <= sz - sz/4;
+}
+
+// size to rehash to when out of room: the same size if dropping the
+// tombstones would leave the table at most half full, otherwise grow.
+// it's important to grow the table really fast; otherwise we waste
+// lots of time rehashing all the keys over and over.
+static size_t eqtable_newsize(uptrint_t *m, size_t sz)
+{
+    if (meta_deleted(m) > 0 && meta_used(m) - meta_deleted(m) < sz/2)
+        return sz;
+    if (sz >= (1<<18) || sz <= (1<<7))
+        return sz<<1;
+    return sz<<2;
+}
+
+static void eqtable_insert(jl_array_t **pa, void *key, void *val, uptrint_t hv);
 
 void jl_idtable_rehash(jl_array_t **pa, size_t newsz)
 {
-    size_t sz = jl_array_len(*pa);
+    jl_array_t *a = *pa;
+    size_t sz = hash_size(a);
     size_t i;
-    void **ol = (void**)(*pa)->data;
-    *pa = jl_alloc_cell_1d(newsz);
-    for(i=0; i < sz; i+=2) {
-        if (ol[i+1] != NULL) {
-            (*jl_table_lookup_bp(pa, ol[i])) = ol[i+1];
+    JL_GC_PUSH1(&a);
+    *pa = eqtable_alloc(newsz);
+    uptrint_t *m = eqtable_meta(a);
+    if (m != NULL) {
+        void **ol = (void**)a->data;
+        for(i=0; i < sz; i++) {
+            if (ol[2*i+1] != NULL)
+                eqtable_insert(pa, ol[2*i], ol[2*i+1], meta_hash(m,i));
         }
     }
+    JL_GC_POP();
 }
 
-static void **jl_table_lookup_bp(jl_array_t **pa, void *key)
+static void eqtable_insert(jl_array_t **pa, void *key, void *val, uptrint_t hv)
 {
-    uint_t hv;
-    jl_array_t *a = *pa;
-    size_t orig, index, iter;
-    size_t newsz, sz = hash_size(a);
-    size_t maxprobe = max_probe(sz);
-    void **tab = (void**)a->data;
-
-    hv = keyhash(key);
- retry_bp:
-    iter = 0;
-    index = h2index(hv,sz);
-    sz *= 2;
-    orig = index;
-
-    do {
-        if (tab[index+1] == NULL) {
-            tab[index] = key;
-            return &tab[index+1];
-        }
-
-        if (jl_egal(key, tab[index]))
-            return &tab[index+1];
-
-        index = (index+2) & (sz-1);
-        iter++;
-        if (iter > maxprobe)
-            break;
-    } while (index != orig);
-
-    /* table full */
-    /* quadruple size, rehash, retry the insert */
-    /* it's important to grow the table really fast; otherwise we waste */
-    /* lots of time rehashing all the keys over and over. */
-    sz = jl_array_len(a);
-    if (sz >= (1<<19) || (sz <= (1<<8)))
-        newsz = sz<<1;
-    else if (sz <= HT_N_INLINE)
-        newsz = HT_N_INLINE;
-    else
-        newsz = sz<<2;
-    jl_idtable_rehash(pa, newsz);
+    jl_array_t *a;
+    uptrint_t *m;
+    void **tab;
+    size_t sz, maxprobe, i, dist;
+    // the entry being placed; starts as key/val and becomes whichever
+    // entry was displaced last
+    void *ckey, *cval;
+    uptrint_t chv;
+    int placed;
 
+ retry:
     a = *pa;
-    tab = (void**)a->data;    
+    m = eqtable_meta(a);
+    if (m == NULL) {
+        jl_idtable_rehash(pa, hash_size(a) < 8 ? 8 : hash_size(a));
+        goto retry;
+    }
     sz = hash_size(a);
     maxprobe = max_probe(sz);
+    tab = (void**)a->data;
+    ckey = key; cval = val; chv = hv;
+    placed = 0;
+    i = h2slot(hv, sz);
+    dist = 0;
 
-    goto retry_bp;
+    while (1) {
+        void *k = tab[2*i];
+        if (k == NULL) {
+            if (!placed && !eqtable_has_room(m, sz))
+                break;
+            meta_used(m)++;
+            goto store;
+        }
+        uptrint_t h = meta_hash(m,i);
+        if (!placed && h == hv && jl_egal(key, k)) {
+            if (tab[2*i+1] == NULL)
+                meta_deleted(m)--;
+            tab[2*i+1] = val;
+            jl_gc_wb(a, val);
+            return;
+        }
+        size_t d = probe_dist(h, i, sz);
+        if (d < dist) {
+            // key is not in the table past this point
+            if (!placed && !eqtable_has_room(m, sz))
+                break;
+            if (tab[2*i+1] == NULL) {
+                meta_deleted(m)--;
+                goto store;
+            }
+            void *tk = tab[2*i], *tv = tab[2*i+1];
+            tab[2*i] = ckey; tab[2*i+1] = cval;
+            meta_hash(m,i) = chv;
+            jl_gc_wb(a, ckey);
+            jl_gc_wb(a, cval);
+            ckey = tk; cval = tv; chv = h;
+            dist = d;
+            placed = 1;
+        }
+        i = (i+1) & (sz-1);
+        dist++;
+        if (dist > maxprobe)
+            break;
+    }
 
-    return NULL;
+    // out of room, or the probe limit was hit. if key was already placed,
+    // the displaced entry is held only here until it is reinserted.
+    {
+        JL_GC_PUSH2(&ckey, &cval);
+        jl_idtable_rehash(pa, eqtable_newsize(m, sz));
+        JL_GC_POP();
+    }
+    if (placed) {
+        key = ckey; val = cval; hv = chv;
+    }
+    goto retry;
+
+ store:
+    tab[2*i] = ckey; tab[2*i+1] = cval;
+    meta_hash(m,i) = chv;
+    jl_gc_wb(a, ckey);
+    jl_gc_wb(a, cval);
 }
 
 /* returns bp if key is in hash, otherwise NULL */
 /* if return is non-NULL and *bp == NULL then key was deleted */
 static void **jl_table_peek_bp(jl_array_t *a, void *key)
 {
+    uptrint_t *m = eqtable_meta(a);
+    if (m == NULL || meta_used(m) == 0)
+        return NULL;
     size_t sz = hash_size(a);
     size_t maxprobe = max_probe(sz);
     void **tab = (void**)a->data;
-    uint_t hv = keyhash(key);
-    size_t index = h2index(hv, sz);
-    sz *= 2;
-    size_t orig = index;
-    size_t iter = 0;
-
-    do {
-        if (tab[index] == NULL)
-            return NULL;
-        if (jl_egal(key, tab[index]))
-            return &tab[index+1];
-
-        index = (index+2) & (sz-1);
-        iter++;
-        if (iter > maxprobe)
-            break;
-    } while (index != orig);
+    uptrint_t hv = keyhash(key);
+    size_t i = h2slot(hv, sz);
+    size_t dist = 0;
 
-    return NULL;
+    while (1) {
+        void *k = tab[2*i];
+        if (k == NULL)
+            return NULL;
+        uptrint_t h = meta_hash(m,i);
+        if (h == hv && jl_egal(key, k))
+            return &tab[2*i+1];
+        if (probe_dist(h, i, sz) < dist)
+            return NULL;
+        i = (i+1) & (sz-1);
+        dist++;
+        if (dist > maxprobe)
+            return NULL;
+    }
 }
 
 DLLEXPORT
 jl_array_t *jl_eqtable_put(jl_array_t *h, void *key, void *val)
 {
-    void **bp = jl_table_lookup_bp(&h, key);
-    *bp = val;
+    eqtable_insert(&h, key, val, keyhash(key));
     return h;
 }
 
@@ -128,6 +232,7 @@ jl_value_t *jl_eqtable_pop(jl_array_t *h, void *key, jl_value_t *deflt)
         return deflt;
     jl_value_t *val = *bp;
     *bp = NULL;
+    meta_deleted(eqtable_meta(h))++;
     return val;
 }
 
@@ -135,7 +240,7 @@ DLLEXPORT
 jl_value_t *jl_eqtable_next(jl_array_t *t, uint32_t i)
 {
     if (i&1) i++;
-    size_t alen = jl_array_dim0(t);
+    size_t alen = 2*hash_size(t);
     while (i < alen && ((void**)t->data)[i+1] == NULL)
         i+=2;
     if (i >= alen) return (jl_value_t*)jl_null;
@@ -151,3 +256,8 @@ jl_value_t *jl_eqtable_next(jl_array_t *t, uint32_t i)
 
 #undef hash_size
 #undef max_probe
+#undef h2slot
+#undef probe_dist
+#undef meta_used
+#undef meta_deleted
+#undef meta_hash
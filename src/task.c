@@ -237,6 +237,8 @@ static void ctx_switch(jl_task_t *t, jl_jmp_buf *where)
 #ifdef JL_GC_MARKSWEEP
         jl_current_task->gcstack = jl_pgcstack;
         jl_pgcstack = t->gcstack;
+        // the task being switched out may have new references on its stack
+        jl_gc_wb_back(jl_current_task);
 #endif
         t->last = jl_current_task;
         // by default, parent is first task to switch to this one
@@ -372,6 +374,7 @@ static void finish_task(jl_task_t *t, jl_value_t *resultval)
     t->done = 1;
     t->runnable = 0;
     t->result = resultval;
+    jl_gc_wb(t, resultval);
     // TODO: early free of t->stkbuf
 #ifdef COPY_STACKS
     t->stkbuf = NULL;
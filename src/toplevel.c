@@ -35,6 +35,8 @@ void jl_add_standard_imports(jl_module_t *m)
 }
 
 extern int base_module_conflict;
+void jl_defer_ambiguity_warnings(int defer);
+
 jl_value_t *jl_eval_module_expr(jl_expr_t *ex)
 {
     assert(ex->head == module_sym);
@@ -77,6 +79,8 @@ jl_value_t *jl_eval_module_expr(jl_expr_t *ex)
     jl_current_module = newm;
 
     jl_array_t *exprs = ((jl_expr_t*)jl_exprarg(ex, 2))->args;
+    // report method ambiguities once the whole module is defined
+    jl_defer_ambiguity_warnings(1);
     JL_TRY {
         for(int i=0; i < jl_array_len(exprs); i++) {
             // process toplevel form
@@ -86,10 +90,12 @@ jl_value_t *jl_eval_module_expr(jl_expr_t *ex)
     }
     JL_CATCH {
         jl_current_module = last_module;
+        jl_defer_ambiguity_warnings(0);
         jl_rethrow();
     }
     JL_GC_POP();
     jl_current_module = last_module;
+    jl_defer_ambiguity_warnings(0);
 
 #if 0
     // some optional post-processing steps
@@ -507,6 +513,7 @@ DLLEXPORT jl_value_t *jl_load_(jl_value_t *str)
 // type definition ------------------------------------------------------------
 
 void jl_reinstantiate_inner_types(jl_datatype_t *t);
+void jl_type_memo_clear(void);
 
 void jl_check_type_tuple(jl_tuple_t *t, jl_sym_t *name, const char *ctx)
 {
@@ -527,10 +534,15 @@ void jl_set_datatype_super(jl_datatype_t *tt, jl_value_t *super)
         jl_errorf("invalid subtyping in definition of %s",tt->name->name->name);
     }
     tt->super = (jl_datatype_t*)super;
+    jl_gc_wb(tt, super);
     if (jl_tuple_len(tt->parameters) > 0) {
         tt->name->cache = (jl_value_t*)jl_null;
+        tt->name->linearcache = (jl_value_t*)jl_null;
+        jl_gc_wb(tt->name, jl_null);
         jl_reinstantiate_inner_types(tt);
     }
+    // subtype results involving tt may have been memoized
+    jl_type_memo_clear();
 }
 
 // method definition ----------------------------------------------------------
@@ -613,6 +625,8 @@ DLLEXPORT jl_value_t *jl_method_def(jl_sym_t *name, jl_value_t **bp, jl_binding_
     if (*bp == NULL) {
         gf = (jl_value_t*)jl_new_generic_function(name);
         *bp = gf;
+        if (bnd)
+            jl_gc_wb_binding(bnd, gf);
     }
     JL_GC_PUSH1(&gf);
     assert(jl_is_function(f));
@@ -624,6 +638,7 @@ DLLEXPORT jl_value_t *jl_method_def(jl_sym_t *name, jl_value_t **bp, jl_binding_
         f->linfo && f->linfo->ast && jl_is_expr(f->linfo->ast)) {
         jl_lambda_info_t *li = f->linfo;
         li->ast = jl_compress_ast(li, li->ast);
+        jl_gc_wb(li, li->ast);
     }
     JL_GC_POP();
     return gf;
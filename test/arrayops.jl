@@ -792,6 +792,45 @@ A = [NaN]; B = [NaN]
 @test isequal(A,B)
 @test A!==B
 
+# bounds checks removed in loops over array indices
+function bce_sum(a)
+    s = 0
+    for i = 1:length(a)
+        s += a[i]
+    end
+    s
+end
+function bce_stencil(a)
+    s = 0.0
+    for j = 2:size(a,2)-1, i = 2:size(a,1)-1
+        s += a[i-1,j] + a[i+1,j] + a[i,j-1] + a[i,j+1]
+    end
+    s
+end
+function bce_pop(a)
+    s = 0
+    for i = 1:length(a)
+        s += a[i]
+        pop!(a)
+    end
+    s
+end
+function bce_past_end(a)
+    s = 0
+    for i = 1:length(a)
+        s += a[i+1]
+    end
+    s
+end
+let
+    @test bce_sum([1:100]) == 5050
+    @test bce_sum(Int[]) == 0
+    @test bce_stencil(ones(4,5)) == 24.0
+    @test bce_stencil(ones(2,2)) == 0.0
+    @test_throws bce_pop([1,2,3,4])
+    @test_throws bce_past_end([1,2,3])
+end
+
 # complete testsuite for reducedim
 
 include("reducedim.jl")
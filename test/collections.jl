@@ -156,6 +156,36 @@ d = {x => 1
 d = (String => String)[ a => "foo" for a in ["a","b","c"]]
 @test d == ["a"=>"foo","b"=>"foo","c"=>"foo"]
 
+# ObjectIdDict growth, deletion and reuse of deleted slots
+let d = ObjectIdDict(), ks = {}
+    for i = 1:2000
+        k = isodd(i) ? i : string(i)
+        push!(ks, k)
+        d[k] = i
+    end
+    @test length(d) == 2000
+    for i = 1:2:2000
+        @test pop!(d, ks[i]) == i
+    end
+    @test length(d) == 1000
+    @test get(d, ks[1], nothing) === nothing
+    for i = 2:2:2000
+        @test d[ks[i]] === i
+    end
+    for i = 1:10000
+        d[-i] = i
+        delete!(d, -i)
+    end
+    @test length(d) == 1000
+    d[ks[1]] = 0
+    @test d[ks[1]] == 0
+    @test length(d) == 1001
+    empty!(d)
+    @test isempty(d)
+    d[:a] = 1
+    @test d[:a] == 1
+end
+
 # ############# end of dict tests #############
 
 # #################### set ####################
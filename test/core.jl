@@ -1281,3 +1281,403 @@ function h5142b(a::Int)
 end
 h5142b(1)
 @test_throws h5142b(2)
+
+# generational gc: old objects given references to young ones
+type GenGCBox
+    x
+end
+let wasgen = ccall(:jl_gc_is_generational, Cint, ())
+    ccall(:jl_gc_set_generational, Void, (Cint,), 1)
+    a = cell(100)
+    b = GenGCBox(nothing)
+    # objects are promoted after surviving two collections
+    gc(); gc()
+    for i = 1:100
+        a[i] = string(i)
+    end
+    b.x = [1,2,3]
+    # allocate enough to trigger some quick collections
+    for i = 1:10^6
+        cell(10)
+    end
+    @test all([a[i] == string(i) for i = 1:100])
+    @test b.x == [1,2,3]
+    ccall(:jl_gc_set_generational, Void, (Cint,), wasgen)
+end
+
+# parallel marking
+let nt = ccall(:jl_gc_mark_threads, Cint, ())
+    ccall(:jl_gc_set_mark_threads, Void, (Cint,), 4)
+    # a long list, to be marked deeper than the per-thread depth limit
+    l = {}
+    for i = 1:10000
+        l = {i, l}
+    end
+    d = [string(i) => i for i = 1:10000]
+    gc(); gc()
+    n = 0
+    while !isempty(l)
+        n += 1
+        l = l[2]
+    end
+    @test n == 10000
+    @test all([d[string(i)] == i for i = 1:10000])
+    ccall(:jl_gc_set_mark_threads, Void, (Cint,), nt)
+end
+
+# lazy sweeping
+let wasgen = ccall(:jl_gc_is_generational, Cint, ()),
+    waslazy = ccall(:jl_gc_is_lazy_sweep, Cint, ())
+    ccall(:jl_gc_set_generational, Void, (Cint,), 0)
+    ccall(:jl_gc_set_lazy_sweep, Void, (Cint,), 1)
+    a = [string(i) for i = 1:10000]
+    gc()
+    # allocation now sweeps the pages left by the collection
+    for i = 1:10^6
+        cell(2)
+    end
+    gc()
+    @test all([a[i] == string(i) for i = 1:10000])
+    ccall(:jl_gc_set_lazy_sweep, Void, (Cint,), waslazy)
+    ccall(:jl_gc_set_generational, Void, (Cint,), wasgen)
+end
+
+# gc policy: soft heap limit and pause target
+let lim = ccall(:jl_gc_heap_limit, Csize_t, ()),
+    pt = ccall(:jl_gc_pause_target, Cdouble, ()),
+    tp = ccall(:jl_gc_throughput, Cdouble, ())
+    ccall(:jl_gc_set_heap_limit, Void, (Csize_t,), 64*1024^2)
+    ccall(:jl_gc_set_pause_target, Void, (Cdouble,), 0.001)
+    ccall(:jl_gc_set_throughput, Void, (Cdouble,), 2.0)
+    @test ccall(:jl_gc_heap_limit, Csize_t, ()) == 64*1024^2
+    @test ccall(:jl_gc_pause_target, Cdouble, ()) == 0.001
+    @test ccall(:jl_gc_throughput, Cdouble, ()) == 1.0
+    a = [string(i) for i = 1:10000]
+    for i = 1:10^6
+        cell(10)
+    end
+    @test all([a[i] == string(i) for i = 1:10000])
+    ccall(:jl_gc_set_heap_limit, Void, (Csize_t,), lim)
+    ccall(:jl_gc_set_pause_target, Void, (Cdouble,), pt)
+    ccall(:jl_gc_set_throughput, Void, (Cdouble,), tp)
+end
+
+# gc statistics and log
+let n = ccall(:jl_gc_num_collections, Uint64, ()),
+    f = tempname()
+    gc_log(f)
+    gc()
+    gc_log(nothing)
+    @test ccall(:jl_gc_num_collections, Uint64, ()) > n
+    s = gc_stats()
+    @test 1 <= length(s) <= 256
+    @test s[end].full == 1
+    @test s[end].live > 0
+    @test length(gc_stats(1)) == 1
+    l = open(readlines, f)
+    @test length(l) >= 1
+    @test beginswith(l[end], "{\"n\":")
+    @test contains(l[end], "\"full\":true")
+    rm(f)
+end
+
+# allocation profiler
+let
+    Profile.init_allocs(10^5, 1024)
+    @profile_allocs for i = 1:10^4
+        Array(Float64, 10)
+    end
+    data = Profile.fetch_allocs()
+    types = Profile.alloc_types()
+    @test length(types) > 0
+    @test length(types) == count(ip->ip == 0, data)
+    @test haskey(Profile.alloc_counts(), Array{Float64,1})
+    Profile.clear_allocs()
+    @test isempty(Profile.fetch_allocs())
+end
+
+# finalizers are queued by the collector and run in batches
+type FinalizedBox
+    x::Int
+end
+let nfinal = 0,
+    n0 = ccall(:jl_gc_num_finalized, Uint64, ()),
+    batch = ccall(:jl_gc_finalizer_batch, Csize_t, ())
+    ccall(:jl_gc_set_finalizer_batch, Void, (Csize_t,), 10)
+    for i = 1:1000
+        finalizer(FinalizedBox(i), b->(nfinal += 1))
+    end
+    # explicit collections run every finalizer that is due
+    gc()
+    @test nfinal == 1000
+    @test ccall(:jl_gc_finalizer_queue_len, Csize_t, ()) == 0
+    @test ccall(:jl_gc_finalizer_queue_max, Csize_t, ()) >= 1000
+    @test ccall(:jl_gc_num_finalized, Uint64, ()) - n0 >= 1000
+    @test ccall(:jl_gc_run_finalizers, Csize_t, ()) == 0
+    ccall(:jl_gc_set_finalizer_batch, Void, (Csize_t,), batch)
+end
+
+# method cache hashed on all argument types
+let
+    gfc(x, y) = 1
+    gfc(x::Int, y::Float64) = 2
+    stats() = (s = zeros(Uint64, 5); ccall(:jl_gf_cache_stats, Void, (Ptr{Uint64},), s); s)
+    args = {1, 1.0, 0x1, 'a', "a", :a, 1//2, int8(1)}
+    for i = 1:2, a in args, b in args
+        @test gfc(a, b) == (isa(a,Int) && isa(b,Float64) ? 2 : 1)
+    end
+    s0 = stats()
+    for a in args, b in args
+        gfc(a, b)
+    end
+    @test stats()[1] - s0[1] >= length(args)^2
+    # new definitions invalidate the cache
+    gfc(x::Int, y::Int) = 3
+    @test gfc(1, 1) == 3
+    @test gfc(1, 1.0) == 2
+    @test gfc(0x1, 1) == 1
+end
+
+# call-site inline caches
+icf(x) = 1
+icf(x::Int) = 2
+icsum(xs) = (s = 0; for x in xs; s += icf(x); end; s)
+let xs = {1, 1.0, 0x1, 'a', "a", 2, 1//2}
+    @test icsum(xs) == 9
+    @test icsum(xs) == 9
+    # new definitions invalidate every cache
+    icf(x::Float64) = 10
+    @test icsum(xs) == 18
+    icf(x::Int) = 0
+    @test icsum(xs) == 15
+    @test icsum({1,1,1}) == 0
+end
+
+# hashed type caches
+let
+    ts = [Array{Array{Int,i},1} for i = 1:200]
+    for i = 1:200
+        @test Array{Array{Int,i},1} === ts[i]
+    end
+    @test Dict{Symbol,(Int,Float64)} === Dict{Symbol,(Int,Float64)}
+    @test Array{Union(Int,Float64),1} === Array{Union(Float64,Int),1}
+    @test Type{Array} !== Type{Array{TypeVar(:T),TypeVar(:N)}}
+end
+
+# memoized subtype and intersection results
+abstract MemoA{T}
+type MemoB{T} <: MemoA{T} end
+let
+    stats() = (s = zeros(Uint64, 4); ccall(:jl_type_memo_stats, Void, (Ptr{Uint64},), s); s)
+    ccall(:jl_type_memo_stats_reset, Void, ())
+    for i = 1:3
+        @test Array{Int,1} <: AbstractArray{Int,1}
+        @test !(Array{Int,2} <: AbstractVector{Int})
+        @test typeintersect(Array{Int,1}, AbstractArray{Int,1}) === Array{Int,1}
+        @test typeintersect(Dict{Int,Int}, Associative{Int,String}) === None
+    end
+    s = stats()
+    @test s[1] > 0 && s[3] > 0
+    # types defined after the memo was filled
+    @test MemoB{Int} <: MemoA{Int}
+    @test !(MemoB{Int} <: MemoA{Float64})
+    gc()
+    @test Array{Int,1} <: AbstractArray{Int,1}
+end
+
+# cache_method widens a slot of a signature it has already compared
+cachewiden(x::ANY, y::ANY) = 1
+cachewiden(x::Int, y::Int) = 2
+let
+    @test cachewiden(1, "s") == 1
+    @test cachewiden(1, 2) == 2
+end
+
+# definitions skip methods whose first argument is unrelated
+module MethodOrder
+using Base.Test
+md(x, y) = 0
+md(x::Integer, y) = 1
+md(x::String, y::Int) = 2
+md(x::Int, y::Int) = 3
+md{T<:Real}(x::T, y::T) = 4
+md(x::String, y) = 5
+md(x::Signed, y::Int) = 6
+@test md(1, 1) == 3
+@test md(int8(1), 1) == 6
+@test md(0x1, 0x1) == 4
+@test md(0x1, "a") == 1
+@test md("a", 1) == 2
+@test md("a", 1.0) == 5
+@test md(1.0, 2.0) == 4
+@test md(:a, 1) == 0
+# an ambiguity resolved later in the same module is not reported
+amb(x::Int, y) = 1
+amb(x, y::Int) = 2
+amb(x::Int, y::Int) = 3
+@test amb(1, 1) == 3
+# general definitions added after specific ones, through the buckets of
+# the first argument's supertypes and subtypes
+bk(x, y) = 0
+bk(x::Number, y::Int) = 1
+bk(x::Int, y::Int) = 2
+bk(x::Real, y::Int) = 3
+bk(x::Integer, y::Int) = 4
+bk(x::Float64, y::String) = 5
+bk{T<:Signed}(x::T, y::Int) = 6
+bk(x::Integer, y::Int) = 7
+@test bk(1, 1) == 2
+@test bk(0x1, 1) == 7
+@test bk(int8(1), 1) == 6
+@test bk(1.0, 1) == 3
+@test bk(1+2im, 1) == 1
+@test bk(1.0, "a") == 5
+@test bk("a", 1) == 0
+let n = 0
+    for m in methods(bk)
+        n += 1
+    end
+    @test n == 7
+end
+end
+
+# dispatch profiler
+dpf(x) = x
+dpf(x::Int) = x+1
+let xs = {1, 1.0, 'a', 2}
+    Profile.clear_dispatch()
+    @profile_dispatch for i = 1:10, x in xs
+        dpf(x)
+    end
+    @test ccall(:jl_dispatch_profile_is_running, Cint, ()) == 0
+    c = filter(c->c.name == :dpf, Profile.fetch_dispatch())
+    @test length(c) == 1
+    @test c[1].calls == 40
+    @test c[1].hits + c[1].slow == c[1].calls
+    @test c[1].slow >= 1
+    Profile.clear_dispatch()
+    @test isempty(Profile.fetch_dispatch())
+end
+
+# specialization limits
+splim(x) = (x,)
+let ts = {1, 1.0, 'a', 0x1, int8(1), int16(1), :a, "a", 1//2, 1.0f0}
+    Base.set_max_specializations(splim, 3)
+    @test Base.max_specializations(splim) == 3
+    for x in ts
+        @test splim(x) === (x,)
+    end
+    nc, ns = Base.method_cache_size(splim)
+    @test ns <= 4
+    @test ccall(:jl_num_widened_specializations, Uint64, ()) > 0
+    for x in ts
+        @test splim(x) === (x,)
+    end
+    @test Base.method_cache_size(splim)[2] == ns
+    Base.set_max_specializations(splim, 0)
+end
+
+# symbol interning
+let syms = [symbol(string("sym_intern_", i)) for i = 1:20000]
+    @test length(unique(syms)) == 20000
+    for i = 1:20000
+        @test symbol(string("sym_intern_", i)) === syms[i]
+    end
+    @test symbol(SubString("xsym_intern_7x", 2, 13)) === syms[7]
+end
+
+# tiered compilation
+function tiersum(n)
+    s = 0
+    for i = 1:n
+        s += i
+    end
+    s
+end
+tiercall(n) = tiersum(n) + 1
+ccall(:jl_set_tiered_compilation, Void, (Cint,), 10)
+# a non-constant binding, so that calls go through the tier trampoline
+tiersum_dyn = tiersum
+let
+    @test tiersum_dyn(1) == 1
+    li = methods(tiersum).defs.func.code.specializations[1]
+    @test ccall(:jl_is_quick_compiled, Cint, (Any,), li) == 1
+    for n = 1:30
+        @test tiercall(n) == div(n*(n+1),2) + 1
+    end
+    @test ccall(:jl_tier_count, Int32, (Any,), li) >= 10
+    @test tiersum_dyn(100) == 5050
+    @test ccall(:jl_is_quick_compiled, Cint, (Any,), li) == 0
+end
+ccall(:jl_set_tiered_compilation, Void, (Cint,), 0)
+
+# optimizing queued functions while idle
+tierasync(x) = x*x + 1
+ccall(:jl_set_tiered_compilation, Void, (Cint,), 5)
+ccall(:jl_set_async_compilation, Void, (Cint,), 1)
+tierasync_dyn = tierasync
+let
+    for i = 1:7
+        @test tierasync_dyn(i) == i*i + 1
+    end
+    # queued after its 5th call, and not yet optimized
+    @test ccall(:jl_tier_run_queue, Cint, (Cint,), 100) >= 1
+    @test ccall(:jl_tier_run_queue, Cint, (Cint,), 100) == 0
+    @test tierasync_dyn(3) == 10
+end
+ccall(:jl_set_async_compilation, Void, (Cint,), 0)
+ccall(:jl_set_tiered_compilation, Void, (Cint,), 0)
+
+# recording compiled specializations
+complog(x) = x + 1
+let
+    Base.start_compile_log()
+    complog(1.5)
+    sigs = Base.stop_compile_log()
+    @test any(s->s[2] == :complog && s[3] == (Float64,), sigs)
+    io = IOBuffer()
+    Base.write_precompile(io, filter(s->s[2] == :complog, sigs))
+    @test contains(takebuf_string(io), "Main.(:complog), (Core.Float64,))")
+end
+
+module CompLogMod
+type CLT{T} end
+clf(x, y) = 1
+end
+let
+    Base.start_compile_log()
+    CompLogMod.clf(CompLogMod.CLT{Int}(), [1.0])
+    sigs = filter(s->s[2] == :clf, Base.stop_compile_log())
+    @test !isempty(sigs)
+    io = IOBuffer()
+    Base.write_precompile(io, sigs)
+    out = takebuf_string(io)
+    @test contains(out, "CompLogMod.(:clf), (CompLogMod.CLT{Core.$(Int)},")
+    for line in split(out, '\n')
+        isempty(line) || eval(Main, parse(line))
+    end
+end
+
+# per-function vectorization
+function vecsum(x)
+    s = zero(eltype(x))
+    for i = 1:length(x)
+        @inbounds s += x[i]
+    end
+    s
+end
+let x = Int32[1:1003]
+    Base.set_vectorize(vecsum, false)
+    @test vecsum(x) == sum(x)
+    Base.set_vectorize(vecsum, true)
+    @test vecsum(Int64[1:1003]) == 503506
+end
+let f = ccall(:jl_cpu_features, Uint32, ())
+    # every x86_64 processor has SSE2
+    if WORD_SIZE == 64 && (f & 0x01) != 0
+        @test (f & 0x02) != 0
+    end
+    # AVX implies SSE4.1, and AVX2 implies AVX
+    @test (f & 0x08) == 0 || (f & 0x04) != 0
+    @test (f & 0x10) == 0 || (f & 0x08) != 0
+end
@@ -34,3 +34,27 @@ end
 @test hash(:(X.x)) != hash(:(X.y))
 
 @test hash([1,2]) == hash(sub([1,2,3,4],1:2))
+
+# egal and object_id of bits-only immutables
+immutable EgalDense
+    a::Int
+    b::Float64
+end
+immutable EgalPadded
+    a::Int8
+    b::Int64
+end
+let d = ObjectIdDict()
+    @test EgalDense(1, 2.0) === EgalDense(1, 2.0)
+    @test EgalDense(1, 2.0) !== EgalDense(1, -2.0)
+    @test object_id(EgalDense(1, 2.0)) == object_id(EgalDense(1, 2.0))
+    @test EgalPadded(1, 2) === EgalPadded(1, 2)
+    @test EgalPadded(1, 2) !== EgalPadded(2, 2)
+    @test object_id(EgalPadded(1, 2)) == object_id(EgalPadded(1, 2))
+    for i = 1:100
+        d[EgalDense(i, i)] = i
+        d[EgalPadded(i, i)] = -i
+    end
+    @test d[EgalDense(7, 7.0)] == 7
+    @test d[EgalPadded(7, 7)] == -7
+end
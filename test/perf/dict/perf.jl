@@ -0,0 +1,50 @@
+include("../perfutil.jl")
+
+## ObjectIdDict with immutable keys ##
+
+immutable Key3
+    a::Int
+    b::Int
+    c::Int
+end
+
+# Int8 followed by Int64 leaves a gap, so these take the per-field path
+immutable PaddedKey
+    a::Int8
+    b::Int64
+end
+
+function oidinsert(n)
+    d = ObjectIdDict()
+    for i = 1:n
+        d[Key3(i, i+1, i+2)] = i
+    end
+    d
+end
+
+function oidlookup(d, n)
+    s = 0
+    for i = 1:n
+        s += get(d, Key3(i, i+1, i+2), 0)
+    end
+    s
+end
+
+@timeit oidinsert(10^5) "oid_insert" "ObjectIdDict insertion with bits-only immutable keys"
+
+const oidkeys = oidinsert(10^5)
+@timeit oidlookup(oidkeys, 10^5) "oid_lookup" "ObjectIdDict lookup with bits-only immutable keys"
+
+function oidpadded(n)
+    d = ObjectIdDict()
+    for i = 1:n
+        d[PaddedKey(i % 127, i)] = i
+    end
+    s = 0
+    for i = 1:n
+        s += get(d, PaddedKey(i % 127, i), 0)
+    end
+    s
+end
+
+@timeit oidpadded(10^5) "oid_padded" "ObjectIdDict insertion and lookup with padded immutable keys"
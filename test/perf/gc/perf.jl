@@ -0,0 +1,46 @@
+include("../perfutil.jl")
+
+## allocation throughput ##
+
+# boxing Float64s
+function boxfloats(n)
+    a = cell(100)
+    x = 0.0
+    for i = 1:n
+        x += 1.0
+        a[(i % 100) + 1] = x
+    end
+    a
+end
+
+@timeit boxfloats(10^6) "box_float64" "Boxing Float64 values"
+
+# small immutables
+immutable Pt
+    x::Int
+    y::Int
+end
+
+function allocpts(n)
+    a = cell(100)
+    for i = 1:n
+        a[(i % 100) + 1] = Pt(i, i+1)
+    end
+    a
+end
+
+@timeit allocpts(10^6) "alloc_immutable" "Allocating small immutables"
+
+# short-lived tuples
+function alloctuples(n)
+    s = 0
+    a = cell(1)
+    for i = 1:n
+        t = (i, i+1, i+2)
+        a[1] = t
+        s += t[2]
+    end
+    s
+end
+
+@timeit alloctuples(10^6) "alloc_tuple" "Allocating small tuples"
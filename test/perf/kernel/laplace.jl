@@ -20,6 +20,31 @@ function laplace_devec()
     u = laplace_iter_devec(u, dx2, dy2, Niter, N)
 end
 
+# the same stencil with loop bounds taken from the array sizes, so that
+# the compiler can tell the indexing is in bounds
+function laplace_step!(uout, u, dx2, dy2)
+    for j = 2:size(u,2)-1
+        for i = 2:size(u,1)-1
+            uout[i,j] = ( (u[i-1,j]+u[i+1,j])*dy2 + (u[i,j-1]+u[i,j+1])*dx2 ) * (1./(2*(dx2+dy2)))
+        end
+    end
+    uout
+end
+
+function laplace_sized()
+    N = 150
+    u = zeros(N, N)
+    u[1,:] = 1
+    uout = copy(u)
+    Niter = 2^10
+    dx2 = dy2 = 0.1*0.1
+    for iter = 1:Niter
+        laplace_step!(uout, u, dx2, dy2)
+        u, uout = uout, u
+    end
+    u
+end
+
 function laplace_iter_vec(u, dx2, dy2, Niter, N)
     for i = 1:Niter
         u[2:N-1, 2:N-1] = ((u[1:N-2, 2:N-1] + u[3:N, 2:N-1])*dy2 + (u[2:N-1,1:N-2] + u[2:N-1, 3:N])*dx2) * (1./ (2*(dx2+dy2)))
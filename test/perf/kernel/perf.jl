@@ -56,6 +56,7 @@ include("actor_centrality.jl")
 include("laplace.jl")
 @timeit1 laplace_vec() "laplace_vec" "Vectorized Laplacian"
 @timeit laplace_devec() "laplace_devec" "Devectorized Laplacian"
+@timeit laplace_sized() "laplace_sized" "Devectorized Laplacian with size-based loop bounds"
 
 # issue #1169
 include("go_benchmark.jl")
@@ -207,3 +208,25 @@ logical_y = map(iseven, 1:length(x))
 @timeit (for n=1:100 add1!(x,logical_y) end) "add1_logical" "Increment x_i if y_i is true"
 @timeit (for n=1:100 devec_add1_logical!(x,logical_y) end) "devec_add1_logical" "Devectorized increment x_i if y_i is true"
 
+
+# loops the vectorizers should handle
+function simd_axpy!(a, x, y)
+    for i = 1:length(x)
+        @inbounds y[i] += a*x[i]
+    end
+    y
+end
+
+function simd_sum(x)
+    s = zero(eltype(x))
+    for i = 1:length(x)
+        @inbounds s += x[i]
+    end
+    s
+end
+
+x = rand(10_000)
+y = rand(10_000)
+xi = rand(Int32, 10_000)
+@timeit (for n=1:1000 simd_axpy!(2.0,x,y) end) "axpy" "Vectorizable a*x+y on Float64 arrays"
+@timeit (for n=1:1000 simd_sum(xi) end) "sum_int32" "Vectorizable sum of an Int32 array"
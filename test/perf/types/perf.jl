@@ -0,0 +1,41 @@
+include("../perfutil.jl")
+
+## type instantiation ##
+
+immutable TP{N} end
+immutable TQ{A,B} end
+
+# large caches of types parameterized by values
+function applyvals(n)
+    s = 0
+    for i = 1:n
+        s += isa(TP{i}, DataType)
+    end
+    s
+end
+
+@timeit applyvals(10^4) "apply_values" "Instantiating a type with many value parameters"
+
+# nested parametric types
+function applynested(n)
+    s = 0
+    for i = 1:n
+        T = TQ{TP{i % 100}, Array{TP{i % 37}, 1}}
+        s += isa(T, DataType)
+    end
+    s
+end
+
+@timeit applynested(10^4) "apply_nested" "Instantiating nested parametric types"
+
+# many element types for Array and Dict
+function applycontainers(n)
+    s = 0
+    for i = 1:n
+        s += isa(Array{TP{i % 1000}, 2}, DataType)
+        s += isa(Dict{TP{i % 1000}, TQ{Int, i % 10}}, DataType)
+    end
+    s
+end
+
+@timeit applycontainers(10^4) "apply_containers" "Instantiating Array and Dict types"
@@ -604,24 +604,32 @@ static int name_visible(char *name, const char *prefix)
     return !strchr(name,'#');
 }
 
-static void symtab_search(jl_sym_t *tree, int *pcount, ios_t *result,
-                          jl_module_t *module, const char *str,
-                          const char *prefix, int plen)
-{
-    do {
-        if (common_prefix(prefix, tree->name) == plen &&
-            name_visible(tree->name, prefix) &&
-            (module ? jl_defines_or_exports_p(module, tree) : (jl_boundp(jl_current_module, tree) ||
-                                                               is_keyword(tree->name)))) {
-            ios_puts(str, result);
-            ios_puts(tree->name + plen, result);
-            ios_putc('\n', result);
-            (*pcount)++;
+typedef struct {
+    jl_module_t *module;
+    const char *prefix;
+    int plen;
+    jl_sym_t **syms;
+    size_t n, maxn;
+} symtab_matches_t;
+
+static void symtab_search(jl_sym_t *sym, void *ctx)
+{
+    symtab_matches_t *m = (symtab_matches_t*)ctx;
+    if (common_prefix(m->prefix, sym->name) == m->plen &&
+        name_visible(sym->name, m->prefix) &&
+        (m->module ? jl_defines_or_exports_p(m->module, sym) : (jl_boundp(jl_current_module, sym) ||
+                                                               is_keyword(sym->name)))) {
+        if (m->n == m->maxn) {
+            m->maxn = m->maxn ? 2*m->maxn : 64;
+            m->syms = (jl_sym_t**)realloc(m->syms, m->maxn*sizeof(jl_sym_t*));
         }
-        if (tree->left)
-            symtab_search(tree->left, pcount, result, module, str, prefix, plen);
-        tree = tree->right;
-    } while (tree != NULL);
+        m->syms[m->n++] = sym;
+    }
+}
+
+static int symbol_name_cmp(const void *a, const void *b)
+{
+    return strcmp((*(jl_sym_t**)a)->name, (*(jl_sym_t**)b)->name);
 }
 
 static jl_module_t *find_submodule_named(jl_module_t *module, const char *name)
@@ -635,10 +643,11 @@ static jl_module_t *find_submodule_named(jl_module_t *module, const char *name)
     return (jl_is_module(b->value)) ? (jl_module_t *)b->value : NULL;
 }
 
-static int symtab_get_matches(jl_sym_t *tree, const char *str, char **answer)
+static int symtab_get_matches(const char *str, char **answer)
 {
-    int x, plen, count=0;
+    int count=0;
     ios_t ans;
+    symtab_matches_t m = { NULL, NULL, 0, NULL, 0, 0 };
 
     // given str "X.Y.a", set module := X.Y and name := "a"
     jl_module_t *module = NULL;
@@ -666,27 +675,27 @@ static int symtab_get_matches(jl_sym_t *tree, const char *str, char **answer)
     }
 
     if (!name) goto symtab_get_matches_exit;
-    plen = strlen(name);
-
-    while (tree != NULL) {
-        x = common_prefix(name, tree->name);
-        if (x == plen) {
-            ios_mem(&ans, 0);
-            symtab_search(tree, &count, &ans, module, str, name, plen);
-            size_t nb;
-            *answer = ios_takebuf(&ans, &nb);
-            break;
-        }
-        else {
-            x = strcmp(name, tree->name);
-            if (x < 0)
-                tree = tree->left;
-            else
-                tree = tree->right;
+    // the symbol table is a hash table, so collect the matches and list
+    // them in name order
+    m.module = module;
+    m.prefix = name;
+    m.plen = strlen(name);
+    jl_foreach_symbol(symtab_search, &m);
+    if (m.n > 0) {
+        qsort(m.syms, m.n, sizeof(jl_sym_t*), symbol_name_cmp);
+        ios_mem(&ans, 0);
+        for(size_t i=0; i < m.n; i++) {
+            ios_puts(str, &ans);
+            ios_puts(m.syms[i]->name + m.plen, &ans);
+            ios_putc('\n', &ans);
         }
+        size_t nb;
+        *answer = ios_takebuf(&ans, &nb);
+        count = m.n;
     }
 
 symtab_get_matches_exit:
+    free(m.syms);
     free(strcopy);
     return count;
 }
@@ -704,7 +713,7 @@ int tab_complete(const char *line, char **answer, int *plen)
     len++;
     *plen = len;
 
-    return symtab_get_matches(jl_get_root_symbol(), &line[len], answer);
+    return symtab_get_matches(&line[len], answer);
 }
 
 static char *do_completions(const char *ch, int c)
@@ -37,10 +37,38 @@ static const char *opts =
     " --no-history             Don't load or save history\n"
     " -f --no-startup          Don't load ~/.juliarc.jl\n"
     " -F                       Load ~/.juliarc.jl, then handle remaining inputs\n"
-    " --color=yes|no           Enable or disable color text\n\n"
+    " --color=yes|no           Enable or disable color text\n"
+    " --trace-compile file     On exit, write precompile statements for the code compiled\n"
+    "                          (include them from base/userimg.jl in a system image build)\n\n"
+
+    " --gc-generational        Use the generational garbage collector\n"
+    " --gc-mark-threads n      Use n threads for GC marking (0 means one per core)\n"
+    " --gc-lazy-sweep          Sweep memory pages on demand, after a collection\n"
+    " --gc-heap-limit size     Collect more often to keep the heap under size (e.g. 2G)\n"
+    " --gc-pause-target ms     Try to keep each collection under ms milliseconds\n"
+    " --gc-throughput t        Favor throughput over the pause target, from 0 to 1\n"
+    " --gc-log file            Append a JSON record of each collection to file\n\n"
+
+    " --compile-tiered[=n]     Compile functions with few optimizations first, and\n"
+    "                          fully after n calls or loop iterations (default 1000)\n"
+    " --compile-async          With --compile-tiered, optimize hot functions while idle\n"
+    " --vectorize=yes|no       Enable or disable loop and SLP vectorization (default no)\n\n"
 
     " -h --help                Print this message\n";
 
+// a byte count, optionally followed by K, M or G
+static size_t parse_size(const char *str)
+{
+    char *end;
+    double n = strtod(str, &end);
+    switch (*end) {
+    case 'g': case 'G': n *= 1024;
+    case 'm': case 'M': n *= 1024;
+    case 'k': case 'K': n *= 1024;
+    }
+    return n > 0 ? (size_t)n : 0;
+}
+
 void parse_opts(int *argcp, char ***argvp) {
     static char* shortopts = "+H:T:hJ:";
     static struct option longopts[] = {
@@ -50,6 +78,16 @@ void parse_opts(int *argcp, char ***argvp) {
         { "lisp",        no_argument,       &lisp_prompt, 1 },
         { "help",        no_argument,       0, 'h' },
         { "sysimage",    required_argument, 0, 'J' },
+        { "gc-generational", no_argument,   0, 'g' },
+        { "gc-mark-threads", required_argument, 0, 'm' },
+        { "gc-lazy-sweep",   no_argument,   0, 's' },
+        { "gc-heap-limit",   required_argument, 0, 'l' },
+        { "gc-pause-target", required_argument, 0, 'u' },
+        { "gc-throughput",   required_argument, 0, 't' },
+        { "gc-log",          required_argument, 0, 'G' },
+        { "compile-tiered",  optional_argument, 0, 'c' },
+        { "compile-async",   no_argument,   0, 'a' },
+        { "vectorize",       required_argument, 0, 'V' },
         { 0, 0, 0, 0 }
     };
     int c;
@@ -82,6 +120,46 @@ void parse_opts(int *argcp, char ***argvp) {
             image_file = strdup(optarg);
             imagepathspecified = 1;
             break;
+        case 'g':
+            jl_gc_set_generational(1);
+            break;
+        case 'm':
+            jl_gc_set_mark_threads(atoi(optarg));
+            break;
+        case 's':
+            jl_gc_set_lazy_sweep(1);
+            break;
+        case 'l':
+            jl_gc_set_heap_limit(parse_size(optarg));
+            break;
+        case 'u':
+            jl_gc_set_pause_target(strtod(optarg, NULL)/1000);
+            break;
+        case 't':
+            jl_gc_set_throughput(strtod(optarg, NULL));
+            break;
+        case 'G':
+            if (jl_gc_set_log_file(optarg) != 0) {
+                ios_printf(ios_stderr, "julia: cannot open GC log file %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'c':
+            jl_set_tiered_compilation(optarg != NULL ? atoi(optarg) : 1000);
+            break;
+        case 'a':
+            jl_set_async_compilation(1);
+            break;
+        case 'V':
+            if (!strcmp(optarg, "yes"))
+                jl_set_vectorize_default(1);
+            else if (!strcmp(optarg, "no"))
+                jl_set_vectorize_default(0);
+            else {
+                ios_printf(ios_stderr, "julia: --vectorize must be yes or no\n");
+                exit(1);
+            }
+            break;
         case 'h':
             printf("%s%s", usage, opts);
             exit(0);